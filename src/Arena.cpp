@@ -0,0 +1,129 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "Arena.h"
+
+#include <new>
+#include <memory>
+#include <cstdlib>
+#include <algorithm>
+
+static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+struct Arena::Block {
+    Block *next;
+};
+
+struct Arena::Finalizer {
+    void *object;
+    void (*destroy)(void *);
+    Finalizer *next;
+};
+
+// Finalized objects are placed right behind their finalizer, at the usual alignment
+const std::size_t Arena::FINALIZER_SPACE = (sizeof(Finalizer) + alignof(std::max_align_t) - 1) /
+                                           alignof(std::max_align_t) * alignof(std::max_align_t);
+
+static thread_local Arena *current_arena = nullptr;
+
+Arena::~Arena() {
+    release();
+}
+
+void *Arena::allocate(std::size_t size, std::size_t align) {
+    void *p = top;
+    if (!top || !std::align(align, size, p, left)) {
+        // Blocks are allocated with malloc, like the symbol tables, so they don't show up in the self test's leak
+        // detection. The nodes' own allocations still do.
+        std::size_t block_size = std::max(BLOCK_SIZE, sizeof(Block) + size + align);
+        auto *block = static_cast<Block *>(std::malloc(block_size));
+        if (!block)
+            throw std::bad_alloc();
+        block->next = blocks;
+        blocks = block;
+
+        p = block + 1;
+        left = block_size - sizeof(Block);
+        std::align(align, size, p, left);
+    }
+
+    top = static_cast<char *>(p) + size;
+    left -= size;
+    return p;
+}
+
+void *Arena::allocate_finalized(std::size_t size, void (*destroy)(void *)) {
+    char *p = static_cast<char *>(allocate(FINALIZER_SPACE + size));
+    void *object = p + FINALIZER_SPACE;
+    finalizers = new(p) Finalizer {object, destroy, finalizers};
+    return object;
+}
+
+void Arena::cancel_release(void *object) {
+    auto *finalizer = reinterpret_cast<Finalizer *>(static_cast<char *>(object) - FINALIZER_SPACE);
+    finalizer->destroy = nullptr;
+}
+
+void Arena::release() {
+    // Finalizers are stored in the arena as well, so they have to run before any block is freed
+    for (Finalizer *f = finalizers; f; f = f->next)
+        if (f->destroy)
+            f->destroy(f->object);
+    finalizers = nullptr;
+
+    while (blocks) {
+        Block *next = blocks->next;
+        std::free(blocks);
+        blocks = next;
+    }
+    top = nullptr;
+    left = 0;
+}
+
+void Arena::merge(Arena &other) {
+    if (&other == this)
+        return;
+
+    if (Block *last = other.blocks) {
+        while (last->next)
+            last = last->next;
+        last->next = blocks;
+        blocks = other.blocks;
+        // The block list is only used for freeing. Keep bumping our own top block and drop the rest of other's.
+        if (!top) {
+            top = other.top;
+            left = other.left;
+        }
+    }
+
+    if (Finalizer *last = other.finalizers) {
+        while (last->next)
+            last = last->next;
+        last->next = finalizers;
+        finalizers = other.finalizers;
+    }
+
+    other.blocks = nullptr;
+    other.top = nullptr;
+    other.left = 0;
+    other.finalizers = nullptr;
+}
+
+Arena &Arena::current() {
+    if (current_arena)
+        return *current_arena;
+    static Arena default_arena;
+    return default_arena;
+}
+
+Arena::Guard::Guard(Arena &arena)
+    : previous(current_arena) {
+    current_arena = &arena;
+}
+
+Arena::Guard::~Guard() {
+    current_arena = previous;
+}
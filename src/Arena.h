@@ -0,0 +1,58 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_ARENA_H
+#define TARIK_ARENA_H
+
+#include <cstddef>
+
+// Bump allocator that owns the syntax trees of a compilation. Nodes are never freed one by one; they live until the
+// arena is released, which destroys them all without walking the trees.
+//
+// AST nodes allocate from the arena that is active on the current thread, see Arena::Guard. Without one, they go to
+// a default arena that lives until the process exits.
+class Arena {
+    struct Block;
+    struct Finalizer;
+
+    static const std::size_t FINALIZER_SPACE;
+
+    Block *blocks = nullptr;
+    char *top = nullptr;
+    std::size_t left = 0;
+    Finalizer *finalizers = nullptr;
+
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    ~Arena();
+
+    void *allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+    // Allocate an object that destroy is run on when the arena is released, in reverse order of allocation. If the
+    // object's constructor throws, the registration has to be dropped again with cancel_release, the object is already
+    // destroyed at that point.
+    void *allocate_finalized(std::size_t size, void (*destroy)(void *));
+    static void cancel_release(void *object);
+    // Destroy everything in the arena and give its memory back
+    void release();
+    // Take over everything other owns, leaving it empty. Other's objects are destroyed before this arena's own.
+    void merge(Arena &other);
+
+    static Arena &current();
+
+    // Makes an arena the current one for this thread, until the guard goes out of scope
+    class Guard {
+        Arena *previous;
+
+    public:
+        explicit Guard(Arena &arena);
+        Guard(const Guard &) = delete;
+        ~Guard();
+    };
+};
+
+#endif //TARIK_ARENA_H
@@ -0,0 +1,64 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++)
+        workers.emplace_back([this] { work(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    // The jthreads join on destruction
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            work_available.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty())
+                return;
+            task = std::move(queue.front());
+            queue.pop_front();
+            running++;
+        }
+
+        task();
+
+        {
+            std::lock_guard lock(mutex);
+            running--;
+            if (queue.empty() && running == 0)
+                work_done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex);
+        queue.push_back(std::move(task));
+    }
+    work_available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock lock(mutex);
+    work_done.wait(lock, [this] { return queue.empty() && running == 0; });
+}
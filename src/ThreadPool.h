@@ -0,0 +1,45 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_THREADPOOL_H
+#define TARIK_THREADPOOL_H
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+// Fixed set of worker threads that run submitted tasks in FIFO order. Tasks must not wait for other tasks, the pool
+// doesn't steal work.
+class ThreadPool {
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    std::deque<std::function<void()>> queue;
+    std::size_t running = 0;
+    bool stopping = false;
+
+    std::vector<std::jthread> workers;
+
+    void work();
+
+public:
+    // Zero means one worker per hardware thread
+    explicit ThreadPool(std::size_t threads = 0);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+    // Block until every submitted task has finished
+    void wait();
+
+    std::size_t size() const { return workers.size(); }
+};
+
+#endif //TARIK_THREADPOOL_H
@@ -3,7 +3,7 @@
 #ifndef VERSION_H
 #define VERSION_H
 
-constinit const char *version_id = "Generic";
-constinit const char *version_string = "0.0.1a";
+inline constinit const char *version_id = "Generic";
+inline constinit const char *version_string = "0.0.1a";
 
 #endif //VERSION_H
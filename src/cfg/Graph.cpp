@@ -0,0 +1,105 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "Graph.h"
+
+#include <format>
+
+namespace cfg
+{
+namespace
+{
+std::string print_operands(const std::vector<Value> &operands) {
+    std::string res;
+    for (Value operand : operands) {
+        if (!res.empty())
+            res += ", ";
+        res += std::format("%{}", operand);
+    }
+    return res;
+}
+
+std::string print_instruction(const Instruction &instruction) {
+    std::string operands = print_operands(instruction.operands);
+    switch (instruction.opcode) {
+    case CONST:
+        return "const " + instruction.expression->print();
+    case ARGUMENT:
+        return std::format("argument {}", instruction.index);
+    case DECLARE:
+        return std::format("declare {} {}", instruction.variable->type.str(), instruction.variable->name.raw);
+    case KILL:
+        return std::format("kill {}", instruction.variable->name.raw);
+    case ADDRESS:
+        return std::format("address {}", instruction.variable->name.raw);
+    case MEMBER:
+        return std::format("member {}, {}", operands, instruction.index);
+    case LOAD:
+        return "load " + operands;
+    case STORE:
+        return "store " + operands;
+    case UNARY:
+        return std::format("{} {}", aast::to_string((aast::PrefixType) instruction.op), operands);
+    case BINARY:
+        return std::format("{} {}", aast::to_string((aast::BinOpType) instruction.op), operands);
+    case CAST:
+        return "cast " + operands;
+    case CALL:
+        return std::format("call {}({})",
+                           ((aast::CallExpression *) instruction.expression)->callee->print(),
+                           operands);
+    }
+    std::unreachable();
+}
+
+std::string print_terminator(const Terminator &terminator) {
+    switch (terminator.kind) {
+    case JUMP:
+        return std::format("jump bb{}", terminator.targets[0]);
+    case BRANCH:
+        return std::format("branch %{}, bb{}, bb{}",
+                           terminator.value.value(),
+                           terminator.targets[0],
+                           terminator.targets[1]);
+    case RETURN:
+        return terminator.value.has_value() ? std::format("return %{}", terminator.value.value()) : "return";
+    case UNREACHABLE:
+        return "unreachable";
+    }
+    std::unreachable();
+}
+}
+
+std::string Function::print() const {
+    std::string res = statement->head() + " {\n";
+
+    for (BlockId id = 0; id < blocks.size(); id++) {
+        const Block &block = blocks[id];
+
+        res += std::format("bb{}:", id);
+        if (!block.predecessors.empty()) {
+            res += " # from";
+            for (BlockId predecessor : block.predecessors)
+                res += std::format(" bb{}", predecessor);
+        }
+        res += '\n';
+
+        for (Value value : block.instructions) {
+            const Instruction &instruction = instructions[value];
+            if (instruction.type == Type(VOID))
+                res += "    " + print_instruction(instruction) + "\n";
+            else
+                res += std::format("    %{}: {} = {}\n",
+                                   value,
+                                   instruction.type->str(),
+                                   print_instruction(instruction));
+        }
+        res += "    " + print_terminator(block.terminator) + "\n";
+    }
+
+    return res + "}";
+}
+} // cfg
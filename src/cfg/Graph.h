@@ -0,0 +1,102 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_CFG_GRAPH_H
+#define TARIK_SRC_CFG_GRAPH_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "semantic/ast/Expression.h"
+#include "semantic/ast/Statements.h"
+
+// Mid-level IR between the semantic AST and LLVM. Every function is a flat list of basic blocks, which hold numbered
+// instructions and end in a terminator with explicit edges to other blocks. Variables live in memory, the same way
+// they do in the generated LLVM IR, so lowering doesn't need to build SSA form.
+namespace cfg
+{
+// Number of the instruction that produces a value. Instructions are numbered in the order of the blocks, so
+// instructions of one block are consecutive.
+using Value = uint32_t;
+using BlockId = uint32_t;
+
+enum Opcode {
+    // A literal, Instruction::expression is the literal expression
+    CONST,
+    // The value passed as argument index
+    ARGUMENT,
+    // A variable comes into scope, with an undefined value
+    DECLARE,
+    // A variable goes out of scope
+    KILL,
+    // Pointer to a variable
+    ADDRESS,
+    // Pointer to member index of the struct operands[0] points to
+    MEMBER,
+    // The value operands[0] points to
+    LOAD,
+    // Write operands[1] to where operands[0] points to
+    STORE,
+    UNARY,
+    BINARY,
+    CAST,
+    // Call Instruction::expression with operands as arguments
+    CALL,
+};
+
+struct Instruction {
+    Opcode opcode;
+    // Type of the produced value, void if there is none
+    TypeId type;
+    std::vector<Value> operands;
+    // The expression this was lowered from, if any
+    aast::Expression *expression = nullptr;
+    // Variable of DECLARE, KILL and ADDRESS
+    aast::VariableStatement *variable = nullptr;
+    // aast::PrefixType of UNARY, aast::BinOpType of BINARY
+    int op = 0;
+    // Index of ARGUMENT and MEMBER
+    std::size_t index = 0;
+};
+
+enum TerminatorKind {
+    JUMP,
+    BRANCH,
+    RETURN,
+    // Blocks that can't be left, i.e. the end of a function that always returns before it
+    UNREACHABLE,
+};
+
+struct Terminator {
+    TerminatorKind kind = UNREACHABLE;
+    // Condition of BRANCH, returned value of RETURN
+    std::optional<Value> value;
+    // BRANCH goes to the first target, if the condition is true, and to the second otherwise
+    std::vector<BlockId> targets;
+};
+
+struct Block {
+    std::vector<Value> instructions;
+    Terminator terminator;
+    // In the order they were lowered
+    std::vector<BlockId> predecessors;
+};
+
+struct Function {
+    aast::FuncStatement *statement;
+    std::vector<Instruction> instructions;
+    // The entry is always the first block. Blocks that can't be reached from it are removed.
+    std::vector<Block> blocks;
+
+    const std::vector<BlockId> &successors(BlockId block) const { return blocks[block].terminator.targets; }
+
+    [[nodiscard]] std::string print() const;
+};
+} // cfg
+
+#endif //TARIK_SRC_CFG_GRAPH_H
@@ -0,0 +1,461 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "Lowering.h"
+
+#include <ranges>
+#include <unordered_map>
+
+namespace cfg
+{
+namespace
+{
+void collect_structures(const std::vector<aast::Statement *> &statements,
+                        std::unordered_map<Path, aast::StructStatement *> &structures) {
+    for (auto *statement : statements) {
+        if (statement->statement_type == aast::STRUCT_STMT) {
+            auto *struct_ = (aast::StructStatement *) statement;
+            structures.emplace(struct_->path, struct_);
+        } else if (statement->statement_type == aast::IMPORT_STMT) {
+            collect_structures(((aast::ImportStatement *) statement)->block, structures);
+        }
+    }
+}
+
+class Lowering {
+    struct Loop {
+        BlockId header, exit;
+        // Number of scopes open outside the loop
+        std::size_t depth;
+    };
+
+    const std::unordered_map<Path, aast::StructStatement *> &structures;
+    std::vector<Function> &functions;
+
+    Function function {};
+    BlockId current = 0;
+    // Whether the current block still needs a terminator
+    bool open = false;
+    // Variables declared in every open scope, in order of declaration
+    std::vector<std::vector<aast::VariableStatement *>> scopes;
+    std::vector<Loop> loops;
+
+public:
+    Lowering(const std::unordered_map<Path, aast::StructStatement *> &structures, std::vector<Function> &functions)
+        : structures(structures),
+          functions(functions) {}
+
+    void lower_declarations(const std::vector<aast::Statement *> &statements);
+    void lower_function(aast::FuncStatement *func);
+
+private:
+    BlockId new_block();
+    void switch_to(BlockId block);
+    Value emit(Instruction instruction);
+    void terminate(Terminator terminator);
+    void jump(BlockId target);
+    void kill_scopes(std::size_t depth);
+
+    void lower_statements(const std::vector<aast::Statement *> &statements);
+    void lower_statement(aast::Statement *statement);
+    void lower_scope(const std::vector<aast::Statement *> &statements);
+    void lower_if(aast::IfStatement *if_);
+    void lower_while(aast::WhileStatement *while_);
+    void declare(aast::VariableStatement *var);
+
+    Value lower_value(aast::Expression *expression);
+    Value lower_address(aast::Expression *expression);
+
+    void finish();
+};
+
+void Lowering::lower_declarations(const std::vector<aast::Statement *> &statements) {
+    for (auto *statement : statements) {
+        if (statement->statement_type == aast::FUNC_STMT)
+            lower_function((aast::FuncStatement *) statement);
+        else if (statement->statement_type == aast::IMPORT_STMT)
+            lower_declarations(((aast::ImportStatement *) statement)->block);
+    }
+}
+
+void Lowering::lower_function(aast::FuncStatement *func) {
+    function = Function {func};
+    switch_to(new_block());
+
+    scopes.emplace_back();
+    for (std::size_t i = 0; i < func->arguments.size(); i++) {
+        aast::VariableStatement *argument = func->arguments[i];
+
+        Value value = emit({.opcode = ARGUMENT, .type = argument->type, .index = i});
+        declare(argument);
+        TypeId pointer = TypeId(argument->type).get_pointer_to();
+        Value address = emit({.opcode = ADDRESS, .type = pointer, .variable = argument});
+        emit({.opcode = STORE, .type = Type(VOID), .operands = {address, value}});
+    }
+
+    lower_statements(func->block);
+
+    // Functions that return a value always do so before reaching their end
+    if (open) {
+        kill_scopes(0);
+        terminate({func->return_type == Type(VOID) ? RETURN : UNREACHABLE});
+    }
+    scopes.pop_back();
+
+    finish();
+    functions.push_back(std::move(function));
+}
+
+BlockId Lowering::new_block() {
+    function.blocks.emplace_back();
+    return function.blocks.size() - 1;
+}
+
+void Lowering::switch_to(BlockId block) {
+    current = block;
+    open = true;
+}
+
+Value Lowering::emit(Instruction instruction) {
+    Value value = function.instructions.size();
+    function.instructions.push_back(std::move(instruction));
+    function.blocks[current].instructions.push_back(value);
+    return value;
+}
+
+void Lowering::terminate(Terminator terminator) {
+    for (BlockId target : terminator.targets)
+        function.blocks[target].predecessors.push_back(current);
+    function.blocks[current].terminator = std::move(terminator);
+    open = false;
+}
+
+void Lowering::jump(BlockId target) {
+    terminate({JUMP, std::nullopt, {target}});
+}
+
+void Lowering::kill_scopes(std::size_t depth) {
+    for (const auto &scope : scopes | std::views::drop(depth) | std::views::reverse) {
+        for (auto *var : scope | std::views::reverse)
+            emit({.opcode = KILL, .type = Type(VOID), .variable = var});
+    }
+}
+
+void Lowering::lower_statements(const std::vector<aast::Statement *> &statements) {
+    for (auto *statement : statements) {
+        // Code after a return, break or continue is still lowered, but ends up in a block that is removed again
+        if (!open)
+            switch_to(new_block());
+        lower_statement(statement);
+    }
+}
+
+void Lowering::lower_statement(aast::Statement *statement) {
+    switch (statement->statement_type) {
+    case aast::SCOPE_STMT:
+        lower_scope(((aast::ScopeStatement *) statement)->block);
+        break;
+    case aast::FUNC_STMT:
+        // Local functions are separate graphs
+        Lowering(structures, functions).lower_function((aast::FuncStatement *) statement);
+        break;
+    case aast::IF_STMT:
+        lower_if((aast::IfStatement *) statement);
+        break;
+    case aast::RETURN_STMT: {
+        auto *return_ = (aast::ReturnStatement *) statement;
+
+        std::optional<Value> value;
+        if (return_->value)
+            value = lower_value(return_->value);
+        kill_scopes(0);
+        terminate({RETURN, value, {}});
+        break;
+    }
+    case aast::WHILE_STMT:
+        lower_while((aast::WhileStatement *) statement);
+        break;
+    case aast::BREAK_STMT:
+        kill_scopes(loops.back().depth);
+        jump(loops.back().exit);
+        break;
+    case aast::CONTINUE_STMT:
+        kill_scopes(loops.back().depth);
+        jump(loops.back().header);
+        break;
+    case aast::VARIABLE_STMT:
+        declare((aast::VariableStatement *) statement);
+        break;
+    case aast::EXPR_STMT:
+        lower_value((aast::Expression *) statement);
+        break;
+    default:
+        break;
+    }
+}
+
+void Lowering::lower_scope(const std::vector<aast::Statement *> &statements) {
+    scopes.emplace_back();
+    lower_statements(statements);
+    if (open)
+        kill_scopes(scopes.size() - 1);
+    scopes.pop_back();
+}
+
+void Lowering::lower_if(aast::IfStatement *if_) {
+    Value condition = lower_value(if_->condition);
+
+    BlockId then_block = new_block();
+    BlockId else_block = if_->else_statement ? new_block() : 0;
+    BlockId join_block = new_block();
+
+    terminate({BRANCH, condition, {then_block, if_->else_statement ? else_block : join_block}});
+
+    switch_to(then_block);
+    lower_scope(if_->block);
+    if (open)
+        jump(join_block);
+
+    if (if_->else_statement) {
+        switch_to(else_block);
+        lower_scope(if_->else_statement->block);
+        if (open)
+            jump(join_block);
+    }
+
+    switch_to(join_block);
+}
+
+void Lowering::lower_while(aast::WhileStatement *while_) {
+    BlockId header = new_block();
+    jump(header);
+
+    switch_to(header);
+    Value condition = lower_value(while_->condition);
+
+    BlockId body = new_block();
+    BlockId exit = new_block();
+    terminate({BRANCH, condition, {body, exit}});
+
+    loops.push_back({header, exit, scopes.size()});
+    switch_to(body);
+    lower_scope(while_->block);
+    if (open)
+        jump(header);
+    loops.pop_back();
+
+    switch_to(exit);
+}
+
+void Lowering::declare(aast::VariableStatement *var) {
+    emit({.opcode = DECLARE, .type = Type(VOID), .variable = var});
+    scopes.back().push_back(var);
+}
+
+Value Lowering::lower_value(aast::Expression *expression) {
+    switch (expression->expression_type) {
+    case aast::CALL_EXPR: {
+        auto *ce = (aast::CallExpression *) expression;
+
+        std::vector<Value> arguments;
+        arguments.reserve(ce->arguments.size());
+        for (auto *argument : ce->arguments)
+            arguments.push_back(lower_value(argument));
+
+        return emit({.opcode = CALL, .type = ce->type, .operands = std::move(arguments), .expression = ce});
+    }
+    case aast::DASH_EXPR:
+    case aast::DOT_EXPR:
+    case aast::EQ_EXPR:
+    case aast::COMP_EXPR: {
+        auto *be = (aast::BinaryExpression *) expression;
+
+        Value left = lower_value(be->left);
+        Value right = lower_value(be->right);
+        return emit({
+            .opcode = BINARY,
+            .type = be->type,
+            .operands = {left, right},
+            .expression = be,
+            .op = be->bin_op_type
+        });
+    }
+    case aast::PREFIX_EXPR: {
+        auto *pe = (aast::PrefixExpression *) expression;
+
+        if (pe->prefix_type == aast::REF)
+            return lower_address(pe->operand);
+
+        Value operand = lower_value(pe->operand);
+        if (pe->prefix_type == aast::DEREF)
+            return emit({.opcode = LOAD, .type = pe->type, .operands = {operand}, .expression = pe});
+        return emit({
+            .opcode = UNARY,
+            .type = pe->type,
+            .operands = {operand},
+            .expression = pe,
+            .op = pe->prefix_type
+        });
+    }
+    case aast::ASSIGN_EXPR: {
+        auto *ae = (aast::BinaryExpression *) expression;
+
+        Value value = lower_value(ae->right);
+        Value address = lower_address(ae->left);
+        emit({.opcode = STORE, .type = Type(VOID), .operands = {address, value}, .expression = ae});
+        return value;
+    }
+    case aast::VAR_EXPR:
+    case aast::MEM_ACC_EXPR: {
+        Value address = lower_address(expression);
+        return emit({.opcode = LOAD, .type = expression->type, .operands = {address}, .expression = expression});
+    }
+    case aast::INT_EXPR:
+    case aast::BOOL_EXPR:
+    case aast::REAL_EXPR:
+    case aast::STR_EXPR:
+        return emit({.opcode = CONST, .type = expression->type, .expression = expression});
+    case aast::CAST_EXPR: {
+        auto *ce = (aast::CastExpression *) expression;
+
+        Value operand = lower_value(ce->expression);
+        return emit({.opcode = CAST, .type = ce->type, .operands = {operand}, .expression = ce});
+    }
+    case aast::NAME_EXPR:
+        // Only member names and callees are names, and those aren't values on their own
+        break;
+    }
+    std::unreachable();
+}
+
+Value Lowering::lower_address(aast::Expression *expression) {
+    switch (expression->expression_type) {
+    case aast::VAR_EXPR: {
+        auto *ve = (aast::VariableExpression *) expression;
+
+        // Struct initialisers fill in their variable before it's used
+        lower_statements(ve->prelude);
+        return emit({.opcode = ADDRESS, .type = ve->type.get_pointer_to(), .expression = ve, .variable = ve->var});
+    }
+    case aast::PREFIX_EXPR: {
+        auto *pe = (aast::PrefixExpression *) expression;
+
+        if (pe->prefix_type == aast::DEREF)
+            return lower_value(pe->operand);
+        break;
+    }
+    case aast::MEM_ACC_EXPR: {
+        auto *mae = (aast::BinaryExpression *) expression;
+
+        // Members are accessed through pointers, as if they were dereferenced first
+        Value left = mae->left->type->pointer_level > 0 ? lower_value(mae->left) : lower_address(mae->left);
+        aast::StructStatement *struct_ = structures.at(mae->left->type->get_user());
+        std::size_t index = struct_->get_member_index(((aast::NameExpression *) mae->right)->name);
+
+        return emit({
+            .opcode = MEMBER,
+            .type = mae->type.get_pointer_to(),
+            .operands = {left},
+            .expression = mae,
+            .index = index
+        });
+    }
+    default:
+        break;
+    }
+
+    // Everything else is a temporary that has to be stored somewhere first
+    auto *temporary = new aast::VariableStatement(expression->origin,
+                                                  expression->type,
+                                                  Token::name("temporary", expression->origin));
+    Value value = lower_value(expression);
+    declare(temporary);
+    Value address = emit({
+        .opcode = ADDRESS,
+        .type = expression->type.get_pointer_to(),
+        .expression = expression,
+        .variable = temporary
+    });
+    emit({.opcode = STORE, .type = Type(VOID), .operands = {address, value}});
+    return address;
+}
+
+void Lowering::finish() {
+    // Find blocks reachable from the entry
+    std::vector<bool> reachable(function.blocks.size());
+    std::vector<BlockId> stack = {0};
+    reachable[0] = true;
+    while (!stack.empty()) {
+        BlockId block = stack.back();
+        stack.pop_back();
+        for (BlockId successor : function.successors(block)) {
+            if (!reachable[successor]) {
+                reachable[successor] = true;
+                stack.push_back(successor);
+            }
+        }
+    }
+
+    // Renumber blocks and instructions, so instructions are numbered in the order of the remaining blocks
+    std::vector<BlockId> block_ids(function.blocks.size());
+    BlockId next_block = 0;
+    for (BlockId block = 0; block < function.blocks.size(); block++) {
+        if (reachable[block])
+            block_ids[block] = next_block++;
+    }
+
+    std::vector<Value> values(function.instructions.size());
+    std::vector<Instruction> instructions;
+    std::vector<Block> blocks;
+    blocks.reserve(next_block);
+
+    for (BlockId id = 0; id < function.blocks.size(); id++) {
+        if (!reachable[id])
+            continue;
+
+        Block &old_block = function.blocks[id];
+        Block &block = blocks.emplace_back();
+
+        for (Value value : old_block.instructions) {
+            values[value] = instructions.size();
+            block.instructions.push_back(instructions.size());
+            instructions.push_back(std::move(function.instructions[value]));
+        }
+
+        block.terminator = std::move(old_block.terminator);
+        for (BlockId &target : block.terminator.targets)
+            target = block_ids[target];
+        for (BlockId predecessor : old_block.predecessors) {
+            if (reachable[predecessor])
+                block.predecessors.push_back(block_ids[predecessor]);
+        }
+    }
+
+    // Values are only used in blocks that their definition dominates, so they are all still there
+    for (Instruction &instruction : instructions) {
+        for (Value &operand : instruction.operands)
+            operand = values[operand];
+    }
+    for (Block &block : blocks) {
+        if (block.terminator.value.has_value())
+            block.terminator.value = values[block.terminator.value.value()];
+    }
+
+    function.instructions = std::move(instructions);
+    function.blocks = std::move(blocks);
+}
+}
+
+std::vector<Function> lower(const std::vector<aast::Statement *> &statements) {
+    // Members are accessed by index, so structures have to be known before any function is lowered
+    std::unordered_map<Path, aast::StructStatement *> structures;
+    collect_structures(statements, structures);
+
+    std::vector<Function> functions;
+    Lowering(structures, functions).lower_declarations(statements);
+    return functions;
+}
+} // cfg
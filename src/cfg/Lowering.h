@@ -0,0 +1,24 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_CFG_LOWERING_H
+#define TARIK_SRC_CFG_LOWERING_H
+
+#include <vector>
+
+#include "Graph.h"
+
+namespace cfg
+{
+// Lower every function in statements to a control flow graph, including those in imports and local functions. Local
+// functions come before the function they are defined in.
+//
+// Scopes, loops and early returns become explicit edges, and every variable is killed on each edge that leaves its
+// scope.
+std::vector<Function> lower(const std::vector<aast::Statement *> &statements);
+} // cfg
+
+#endif //TARIK_SRC_CFG_LOWERING_H
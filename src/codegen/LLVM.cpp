@@ -173,9 +173,9 @@ bool LLVM::generate_scope(aast::ScopeStatement *scope, bool is_last) {
 void LLVM::generate_function(aast::FuncStatement *func) {
     variables.clear();
 
-    llvm::FunctionType *func_type = functions.at(func->path.str());
+    llvm::FunctionType *func_type = functions.at(Symbol(func->path.str()));
 
-    llvm::Function *llvm_func = function_bodies.at(func->path.str());
+    llvm::Function *llvm_func = function_bodies.at(Symbol(func->path.str()));
     llvm::BasicBlock *entry = llvm::BasicBlock::Create(context, "func_entry", llvm_func);
     builder.SetInsertPoint(entry);
     current_function = llvm_func;
@@ -184,16 +184,14 @@ void LLVM::generate_function(aast::FuncStatement *func) {
     for (auto &arg : llvm_func->args()) {
         arg.setName((*it)->name.raw);
         if ((*it)->written_to) {
-            auto arg_var = builder.CreateAlloca(arg.getType(), 0u, nullptr, "stack_" + (*it)->name.raw);
+            auto arg_var = builder.CreateAlloca(arg.getType(), 0u, nullptr, "stack_" + std::string((*it)->name.raw));
             builder.CreateStore(&arg, arg_var);
-            variables.emplace((*it)->name.raw, std::make_tuple(arg_var, arg.getType(), false));
+            variables.emplace((*it)->name.symbol, std::make_tuple(arg_var, arg.getType(), false));
         } else
-            variables.emplace((*it)->name.raw, std::make_tuple(&arg, arg.getType(), true));
+            variables.emplace((*it)->name.symbol, std::make_tuple(&arg, arg.getType(), true));
         ++it;
     }
     return_type = func_type->getReturnType();
-    if (return_type->isIntegerTy())
-        return_type_signed_int = func->return_type.is_signed_int();
 
     generate_scope(func, true);
 
@@ -205,7 +203,8 @@ void LLVM::generate_function(aast::FuncStatement *func) {
 
 void LLVM::generate_func_decl(aast::FuncDeclareStatement *decl) {
     llvm::FunctionType *func_type = make_llvm_function_type(decl);
-    functions.emplace(decl->path.str(), func_type);
+    Symbol path = Symbol(decl->path.str());
+    functions.emplace(path, func_type);
 
     std::string func_name = decl->linker_name;
     if (func_name.empty())
@@ -215,10 +214,10 @@ void LLVM::generate_func_decl(aast::FuncDeclareStatement *decl) {
                                                        llvm::Function::ExternalLinkage,
                                                        func_name,
                                                        module.get());
-    function_bodies.emplace(decl->path.str(), llvm_func);
+    function_bodies.emplace(path, llvm_func);
 
     if (!decl->linker_name.empty())
-        function_maps.emplace(decl->path.str(), decl->linker_name);
+        function_maps.emplace(path, decl->linker_name);
 }
 
 void LLVM::generate_if(aast::IfStatement *if_, bool is_last) {
@@ -264,8 +263,10 @@ void LLVM::generate_else(aast::ElseStatement *) {
 void LLVM::generate_return(aast::ReturnStatement *return_) {
     if (!return_type)
         return;
-    if (return_->value)
-        builder.CreateRet(generate_cast(generate_expression(return_->value), return_type, return_type_signed_int));
+    if (return_->value) {
+        llvm::Value *value = generate_expression(return_->value);
+        builder.CreateRet(generate_cast(value, return_type, return_->value->type->is_signed_int()));
+    }
     else
         builder.CreateRetVoid();
 }
@@ -312,7 +313,7 @@ void LLVM::generate_continue(aast::ContinueStatement *) {
 
 void LLVM::generate_variable(aast::VariableStatement *var) {
     llvm::Type *type = make_llvm_type(var->type);
-    variables.emplace(var->name.raw,
+    variables.emplace(var->name.symbol,
                       std::make_tuple(builder.CreateAlloca(type, 0u, nullptr, var->name.raw),
                                       type,
                                       false));
@@ -324,8 +325,8 @@ void LLVM::generate_struct(aast::StructStatement *struct_) {
         members.push_back(make_llvm_type(member->type));
     }
 
-    structures.emplace(struct_->path.str(), llvm::StructType::create(context, members, struct_->path.str()));
-    struct_statements.emplace(struct_->path.str(), struct_);
+    structures.emplace(struct_->path, llvm::StructType::create(context, members, struct_->path.str()));
+    struct_statements.emplace(struct_->path, struct_);
 }
 
 void LLVM::generate_import(aast::ImportStatement *import_, bool is_last) {
@@ -346,7 +347,7 @@ int roundUp(T numToRound, T multiple) {
 }
 
 llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
-    generate_statements(expression->prelude);
+    generate_statements(expression->get_prelude());
     switch (expression->expression_type) {
         case aast::CALL_EXPR: {
             auto *ce = (aast::CallExpression *) expression;
@@ -354,9 +355,10 @@ llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
 
             if (ce->callee->expression_type == aast::NAME_EXPR) {
                 std::string name = ((aast::NameExpression *) ce->callee)->name;
-                llvm::FunctionType *func_type = functions.at(name);
-                if (function_maps.contains(name)) {
-                    name = function_maps.at(name);
+                Symbol path = Symbol(name);
+                llvm::FunctionType *func_type = functions.at(path);
+                if (function_maps.contains(path)) {
+                    name = function_maps.at(path);
                 }
                 function = module->getOrInsertFunction(name, func_type);
             } else {
@@ -373,7 +375,7 @@ llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
                 } else {
                     arg_values.push_back(generate_cast(generate_expression(arg),
                                                        function.getFunctionType()->getParamType(arg_i++),
-                                                       arg->type.is_signed_int()));
+                                                       arg->type->is_signed_int()));
                 }
             }
             const char *name = "";
@@ -388,15 +390,15 @@ llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
             auto *ce = (aast::BinaryExpression *) expression;
 
             llvm::Value *left = generate_expression(ce->left), *right = generate_expression(ce->right);
-            bool unsigned_int = ce->left->type.is_unsigned_int() || ce->right->type.is_unsigned_int();
+            bool unsigned_int = ce->left->type->is_unsigned_int() || ce->right->type->is_unsigned_int();
             // After validation, implicit casts are never from float to integer or vice versa
-            Type rt = ce->left->type.get_result(ce->right->type);
+            Type rt = ce->left->type->get_result(ce->right->type);
             llvm::Type *result_type = make_llvm_type(rt);
             bool fp = result_type->isFloatingPointTy();
 
-            // signed_int parameter doesn't matter, because we never cast from float to int or vice versa implicitly
-            left = generate_cast(left, result_type);
-            right = generate_cast(right, result_type);
+            // We never cast from float to int or vice versa implicitly, so operands are only extended by their own sign
+            left = generate_cast(left, result_type, ce->left->type->is_signed_int());
+            right = generate_cast(right, result_type, ce->right->type->is_signed_int());
 
             switch (ce->bin_op_type) {
                 case aast::ADD:
@@ -433,7 +435,7 @@ llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
                         return builder.CreateICmpNE(left, right, "neq_temp");
                 case aast::SM:
                     if (fp)
-                        return builder.CreateFCmpOLE(left, right, "sm_temp");
+                        return builder.CreateFCmpOLT(left, right, "sm_temp");
                     else if (unsigned_int)
                         return builder.CreateICmpULT(left, right, "sm_temp");
                     else
@@ -472,7 +474,7 @@ llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
 
             if (pe->prefix_type == aast::REF) {
                 if (pe->operand->expression_type == aast::VAR_EXPR) {
-                    auto [var, type, is_arg] = get_var_on_stack(pe->operand->flatten_to_member_access());
+                    auto [var, type, is_arg] = get_var_on_stack(Symbol(pe->operand->flatten_to_member_access()));
                     return var;
                 } else if (pe->operand->expression_type == aast::MEM_ACC_EXPR) {
                     return generate_member_access((aast::BinaryExpression *) pe->operand);
@@ -505,7 +507,7 @@ llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
             llvm::Value *dest;
             llvm::Type *dest_type;
             if (ae->left->expression_type == aast::VAR_EXPR) {
-                auto [var, type, is_arg] = get_var_on_stack(ae->left->flatten_to_member_access());
+                auto [var, type, is_arg] = get_var_on_stack(Symbol(ae->left->flatten_to_member_access()));
                 dest = var;
                 dest_type = type;
             } else if (ae->left->expression_type == aast::MEM_ACC_EXPR) {
@@ -520,11 +522,12 @@ llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
                 dest = generate_expression(ae->left);
                 dest_type = dest->getType();
             }
-            return builder.CreateStore(generate_cast(generate_expression(ae->right), dest_type), dest);
+            llvm::Value *value = generate_expression(ae->right);
+            return builder.CreateStore(generate_cast(value, dest_type, ae->right->type->is_signed_int()), dest);
         }
     case aast::VAR_EXPR: {
         auto *ne = (aast::VariableExpression *) expression;
-        auto [var, type, is_arg] = variables.at(ne->flatten_to_member_access());
+        auto [var, type, is_arg] = variables.at(Symbol(ne->flatten_to_member_access()));
         if (is_arg)
             return var;
         else
@@ -532,6 +535,10 @@ llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
     }
     case aast::INT_EXPR: {
         auto *ie = (aast::IntExpression *) expression;
+        // Folded constants keep the type of the expression they replaced
+        if (ie->type != aast::IntExpression::literal_type())
+            return llvm::ConstantInt::get(make_llvm_type(ie->type), ie->n, ie->type->is_signed_int());
+
         size_t width = std::max(8, roundUp((size_t) std::bit_width((size_t) ie->n), size_t(8)));
 
         if (ie->n >= 0) {
@@ -570,10 +577,11 @@ llvm::Value *LLVM::generate_expression(aast::Expression *expression) {
     }
     case aast::CAST_EXPR: {
         auto *ce = (aast::CastExpression *) expression;
-        return generate_cast(generate_expression(ce->expression),
-                             make_llvm_type(ce->type),
-                             ce->expression->type.is_signed_int()
-                             || ce->type.is_signed_int());
+        llvm::Value *value = generate_expression(ce->expression);
+        // Integers are extended by their own sign, floats are converted to the target's
+        bool signed_int = ce->expression->type->is_float() ? ce->type->is_signed_int()
+                                                            : ce->expression->type->is_signed_int();
+        return generate_cast(value, make_llvm_type(ce->type), signed_int);
     }
     }
     return nullptr;
@@ -607,11 +615,11 @@ llvm::Value *LLVM::generate_cast(llvm::Value *val, llvm::Type *type, bool signed
     return builder.CreateCast(co, val, type, "cast_temp");
 }
 
-std::tuple<llvm::Value *, llvm::Type *, bool> LLVM::get_var_on_stack(std::string name) {
+std::tuple<llvm::Value *, llvm::Type *, bool> LLVM::get_var_on_stack(Symbol name) {
     auto &[var, type, is_arg] = variables.at(name);
 
     if (is_arg) {
-        llvm::AllocaInst *alloca = builder.CreateAlloca(type, 0u, nullptr, "stack_" + name);
+        llvm::AllocaInst *alloca = builder.CreateAlloca(type, 0u, nullptr, "stack_" + std::string(name.str()));
         builder.CreateStore(var, alloca);
 
         var = alloca;
@@ -621,10 +629,13 @@ std::tuple<llvm::Value *, llvm::Type *, bool> LLVM::get_var_on_stack(std::string
     return std::make_tuple(var, type, false);
 }
 
-llvm::Type *LLVM::make_llvm_type(const Type &t) {
+llvm::Type *LLVM::make_llvm_type(TypeId t) {
+    if (t.get_id() < llvm_types.size() && llvm_types[t.get_id()])
+        return llvm_types[t.get_id()];
+
     llvm::Type *res = nullptr;
-    if (t.is_primitive()) {
-        switch (t.get_primitive()) {
+    if (t->is_primitive()) {
+        switch (t->get_primitive()) {
             case U8:
             case I8:
             case STR:
@@ -655,13 +666,16 @@ llvm::Type *LLVM::make_llvm_type(const Type &t) {
                 res = llvm::Type::getVoidTy(context);
         }
     } else {
-        res = structures.at(t.base());
+        res = structures.at(t->get_user());
     }
 
-    for (int i = 0; i < t.pointer_level; i++) {
+    for (int i = 0; i < t->pointer_level; i++) {
         res = llvm::PointerType::getUnqual(context);
     }
 
+    if (t.get_id() >= llvm_types.size())
+        llvm_types.resize(t.get_id() + 1);
+    llvm_types[t.get_id()] = res;
     return res;
 }
 
@@ -680,19 +694,17 @@ llvm::Value *LLVM::generate_member_access(aast::BinaryExpression *mae) {
     std::string member_name = ((aast::NameExpression *) mae->right)->name;
 
     llvm::Value *left;
-    std::string struct_;
-    bool pointer = mae->left->type.pointer_level > 0;
+    Path struct_ = mae->left->type->get_user();
+    bool pointer = mae->left->type->pointer_level > 0;
 
     if (mae->left->expression_type == aast::VAR_EXPR) {
         std::string var_name = mae->left->flatten_to_member_access();
-        auto [var, type, is_arg] = variables.at(var_name);
+        auto [var, type, is_arg] = variables.at(Symbol(var_name));
 
         left = var;
-        struct_ = mae->left->type.base();
         pointer = pointer && !is_arg;
     } else {
         left = generate_expression(mae->left);
-        struct_ = mae->left->type.base();
     }
     llvm::Type *struct_type = structures.at(struct_);
     unsigned int member_index = struct_statements.at(struct_)->get_member_index(member_name);
@@ -21,15 +21,16 @@
 class LLVM {
     std::unique_ptr<llvm::Module> module;
     llvm::Type *return_type = nullptr;
-    bool return_type_signed_int = false;
     llvm::Function *current_function = nullptr;
     llvm::BasicBlock *last_loop_entry = nullptr, *last_loop_exit = nullptr;
-    std::unordered_map<std::string, llvm::FunctionType *> functions;
-    std::unordered_map<std::string, llvm::Function *> function_bodies;
-    std::unordered_map<std::string, std::tuple<llvm::Value *, llvm::Type *, bool>> variables;
-    std::unordered_map<std::string, llvm::StructType *> structures;
-    std::unordered_map<std::string, aast::StructStatement *> struct_statements;
-    std::unordered_map<std::string, std::string> function_maps;
+    std::unordered_map<Symbol, llvm::FunctionType *> functions;
+    std::unordered_map<Symbol, llvm::Function *> function_bodies;
+    std::unordered_map<Symbol, std::tuple<llvm::Value *, llvm::Type *, bool>> variables;
+    std::unordered_map<Path, llvm::StructType *> structures;
+    std::unordered_map<Path, aast::StructStatement *> struct_statements;
+    // LLVM types by type ID, null where not made yet
+    std::vector<llvm::Type *> llvm_types;
+    std::unordered_map<Symbol, std::string> function_maps;
 
 public:
     static inline std::string default_triple = llvm::sys::getDefaultTargetTriple();
@@ -85,8 +86,8 @@ protected:
     llvm::Value *generate_expression(aast::Expression *expression);
     static llvm::Value *generate_cast(llvm::Value *val, llvm::Type *type, bool signed_int = true);
 
-    std::tuple<llvm::Value *, llvm::Type *, bool> get_var_on_stack(std::string name);
-    llvm::Type *make_llvm_type(const Type &t);
+    std::tuple<llvm::Value *, llvm::Type *, bool> get_var_on_stack(Symbol name);
+    llvm::Type *make_llvm_type(TypeId t);
     llvm::FunctionType *make_llvm_function_type(aast::FuncStCommon *func);
     llvm::Value *generate_member_access(aast::BinaryExpression *mae);
 };
@@ -30,15 +30,34 @@ std::vector<Error> Bucket::get_errors() {
 
     std::vector<Error> error_vec(errors.begin(), errors.end());
 
-    std::stable_sort(error_vec.begin(),
-                     error_vec.end(),
-                     [](const Error &e1, const Error &e2) {
-                         return !(e1.origin > e2.origin);
-                     });
+    // Diagnostics are merged from other buckets, possibly filled on other threads, and kept in a hash set, so the order
+    // is entirely decided here: by position, and at the same position by kind and message
+    std::ranges::sort(error_vec,
+                      [](const Error &e1, const Error &e2) {
+                          if (e1.origin != e2.origin)
+                              return e2.origin > e1.origin;
+                          if (e1.kind != e2.kind)
+                              return e1.kind < e2.kind;
+                          return e1.message < e2.message;
+                      });
 
     return error_vec;
 }
 
+void Bucket::merge(Bucket &other) {
+    clear_staging_error({}, {}, ErrorKind::STAGING);
+    other.clear_staging_error({}, {}, ErrorKind::STAGING);
+
+    for (Error error : other.errors) {
+        error.bucket = this;
+        errors.emplace(std::move(error));
+    }
+    error_count += other.error_count;
+
+    other.errors.clear();
+    other.error_count = 0;
+}
+
 void Bucket::print_errors() {
     for (const auto &error : get_errors()) {
         error.print();
@@ -40,6 +40,9 @@ public:
     size_t get_error_count();
     std::vector<Error> get_errors();
 
+    // Move all diagnostics of other into this bucket
+    void merge(Bucket &other);
+
     void print_errors();
 };
 
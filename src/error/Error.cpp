@@ -6,9 +6,11 @@
 
 #include "Error.h"
 
-#include <comperr.h>
+#include <algorithm>
+#include <iostream>
 
 #include "Bucket.h"
+#include "lexical/Source.h"
 
 bool Error::assert(bool cond) {
     if (!cond) {
@@ -55,20 +57,60 @@ std::size_t std::hash<Error>::operator()(const Error &e) const noexcept {
     return seed;
 }
 
+namespace
+{
+// Print a diagnostic with the line it points at. The line is taken from the file's buffer, so files aren't read again
+// and in-memory buffers work as well. The underline stops at the end of the first line.
+void report(const LexerRange &pos, const std::string &what, std::string_view kind, std::string_view colour) {
+    const SourceFile &file = SourceManager::get(pos.file);
+    int line = file.line(pos.offset);
+
+    std::cerr << "\x1b[1m";
+    if (!file.get_name().empty()) {
+        std::cerr << file.get_name();
+        if (line != 0)
+            std::cerr << ':' << line << ':' << file.column(pos.offset);
+        std::cerr << ": ";
+    }
+    std::cerr << colour << kind << ":\x1b[0;1m " << what << "\x1b[0m\n";
+
+    // The file's contents aren't known
+    if (line == 0)
+        return;
+
+    uint32_t line_start = pos.offset - (file.column(pos.offset) - 1);
+    uint32_t line_end = std::max(file.line_end(pos.offset), pos.offset);
+    std::string_view source = file.text().substr(line_start, line_end - line_start);
+    if (source.ends_with('\r'))
+        source.remove_suffix(1);
+    uint32_t length = std::max(std::min(pos.length, line_end - pos.offset), (uint32_t) 1);
+
+    // Tabs before the range are kept, so the underline lines up however wide they are displayed
+    std::string indent;
+    for (char c : source.substr(0, std::min<std::size_t>(pos.offset - line_start, source.size())))
+        indent += c == '\t' ? '\t' : ' ';
+
+    std::string number = std::to_string(line);
+    std::cerr << ' ' << number << " | " << source << '\n';
+    std::cerr << ' ' << std::string(number.size(), ' ') << " | " << indent << colour << '^'
+              << std::string(length - 1, '~') << "\x1b[0m\n";
+}
+}
+
 void verror(const LexerRange &pos, const std::string &what) {
-    comperr(what.c_str(), ERROR, pos.filename.c_str(), pos.l, pos.p, pos.length);
+    report(pos, what, "error", "\x1b[31m");
 }
 
 void vwarning(const LexerRange &pos, const std::string &what) {
-    comperr(what.c_str(), WARNING, pos.filename.c_str(), pos.l, pos.p, pos.length);
+    report(pos, what, "warning", "\x1b[35m");
 }
 
 void vnote(const LexerRange &pos, const std::string &what) {
-    comperr(what.c_str(), NOTE, pos.filename.c_str(), pos.l, pos.p, pos.length);
+    report(pos, what, "note", "\x1b[36m");
 }
 
 bool viassert(bool cond, const LexerRange &pos, const std::string &what) {
     if (!cond)
-        comperr(what.c_str(), ERROR, pos.filename.c_str(), pos.l, pos.p, pos.length);
+        report(pos, what, "error", "\x1b[31m");
     return cond;
 }
@@ -1,4 +1,4 @@
-// tarik (c) Nikolas Wipper 2020-2024
+// tarik (c) Nikolas Wipper 2020-2025
 
 /* This Source Code Form is subject to the terms of the Mozilla Public
  * License, v. 2.0. If a copy of the MPL was not distributed with this
@@ -6,264 +6,198 @@
 
 #include "Lexer.h"
 
+#include "Scan.h"
+
 #include <cstring>
-#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <algorithm>
 
+static const SourceFile *load_or_report(const std::filesystem::path &f) {
+    if (const SourceFile *file = SourceManager::load(f))
+        return file;
+    std::cerr << "Couldn't open " << f << ": " << std::strerror(errno) << std::endl;
+    // Lex an empty file instead, so that errors still point at the right file name
+    return SourceManager::add(f, "");
+}
+
 Lexer::Lexer(std::istream *s)
-    : stream(s) {}
+    : Lexer(SourceManager::add("", std::string(std::istreambuf_iterator<char>(*s), {}))) {}
 
 Lexer::Lexer(const std::filesystem::path &f)
-    : Lexer(new std::ifstream(f)) {
-    if (stream->fail()) {
-        std::cerr << "Couldn't open " << f << ": " << std::strerror(errno) << std::endl;
-    }
-    allocated = true;
-    pos.filename = f;
+    : Lexer(load_or_report(f)) {}
+
+Lexer::Lexer(const SourceFile *file)
+    : file(file->get_id()),
+      source(file->text()) {
+    tokenize();
 }
 
-Lexer::~Lexer() {
-    if (allocated)
-        delete stream;
+bool Lexer::at_end() const {
+    return cursor >= source.size();
 }
 
-bool Lexer::operator_startswith(char c) {
-    if (operators.contains({c}))
-        return true;
-    return std::any_of(operators.begin(),
-                       operators.end(),
-                       [c](std::pair<std::string, TokenType> op) {
-                           return op.first[0] == c;
-                       });
+char Lexer::peek_char(size_t dist) const {
+    if (cursor + dist >= source.size())
+        return 0;
+    return source[cursor + dist];
 }
 
-bool Lexer::operator_startswith(const std::string &c) {
-    if (operators.contains(c))
-        return true;
-    return std::any_of(operators.begin(),
-                       operators.end(),
-                       [c](auto op) {
-                           if (op.first.size() < c.size())
-                               return false;
-                           return memcmp(op.first.data(), c.data(), c.size()) == 0;
-                       });
+char Lexer::read_char() {
+    return source[cursor++];
 }
 
-char Lexer::read_stream() {
-    if (stream->fail())
-        return -1;
-    char c = (char) stream->get();
-    if (c == '\n') {
-        pos.l++;
-        pos.p = 1;
-    } else
-        pos.p++;
-    return c;
+LexerRange Lexer::range_from(size_t start) const {
+    return LexerRange {{file, (uint32_t) start}, (uint32_t) (cursor - start)};
 }
 
-char Lexer::peek_stream() {
-    return (char) stream->peek();
+void Lexer::skip_whitespace() {
+    while (!at_end()) {
+        cursor += scan_whitespace(source.substr(cursor));
+        if (peek_char() != '#')
+            break;
+        // Comments run up to and including the line break
+        cursor += scan_until(source.substr(cursor), '\n');
+        if (!at_end())
+            read_char();
+    }
 }
 
-void Lexer::unget_stream() {
-    --pos;
-    stream->unget();
+void Lexer::tokenize() {
+    // Most tokens are a few characters long, so this avoids nearly all reallocations
+    tokens.reserve(source.size() / 4 + 1);
+
+    do {
+        tokens.push_back(lex());
+    } while (tokens.back().id != END);
 }
 
 Lexer::State Lexer::checkpoint() const {
     return State {
-        .pos = pos,
-        .streampos = stream->tellg()
+        .pos = index > 0 ? tokens[index - 1].origin.end() : LexerPos {file, 0},
+        .index = index
     };
 }
 
 void Lexer::rollback(State state) {
-    stream->clear();
-    stream->seekg(state.streampos);
-    pos = state.pos;
+    index = state.index;
 }
 
-Token Lexer::peek(int dist) {
-    State state = checkpoint();
-    Token t = consume();
-    for (int i = 0; i < dist; i++) {
-        t = consume();
-    }
-    rollback(state);
+const Token &Lexer::peek(int dist) const {
+    size_t i = std::min(index + std::max(dist, 0), tokens.size() - 1);
+    return tokens[i];
+}
+
+const Token &Lexer::consume() {
+    const Token &t = tokens[index];
+    if (index + 1 < tokens.size())
+        index++;
     return t;
 }
 
-std::string post_process_string(std::string s) {
+static std::string unescape_string(std::string_view s) {
+    std::string res;
+    res.reserve(s.size());
+
     for (size_t i = 0; i < s.size(); i++) {
-        if (s[i] == '\\') {
-            s.erase(i, 1);
-            switch (s[i]) {
-            case '?':
-                s[i] = '\?';
-                break;
-            case '\\':
-                break;
-            case 'a':
-                s[i] = '\a';
-                break;
-            case 'b':
-                s[i] = '\b';
-                break;
-            case 'f':
-                s[i] = '\f';
-                break;
-            case 'n':
-                s[i] = '\n';
-                break;
-            case 'r':
-                s[i] = '\r';
-                break;
-            case 't':
-                s[i] = '\t';
-                break;
-            case 'v':
-                s[i] = '\v';
-                break;
-            }
+        if (s[i] != '\\') {
+            res.push_back(s[i]);
+            continue;
+        }
+        if (++i == s.size())
+            break;
+
+        switch (s[i]) {
+        case 'a':
+            res.push_back('\a');
+            break;
+        case 'b':
+            res.push_back('\b');
+            break;
+        case 'f':
+            res.push_back('\f');
+            break;
+        case 'n':
+            res.push_back('\n');
+            break;
+        case 'r':
+            res.push_back('\r');
+            break;
+        case 't':
+            res.push_back('\t');
+            break;
+        case 'v':
+            res.push_back('\v');
+            break;
+        default:
+            res.push_back(s[i]);
+            break;
         }
     }
 
-    return s;
+    return res;
 }
 
-Token Lexer::consume() {
-    std::string tok;
-    bool num = false, real = false, op = false, string = false;
+Token Lexer::lex() {
+    skip_whitespace();
 
-    while (isspace(peek_stream()))
-        read_stream();
+    size_t start = cursor;
 
-    LexerPos actual_pos = pos;
-
-    while (stream->good()) {
-        char c = read_stream();
-        if (c < 0)
-            break;
+    if (at_end())
+        return Token::view(END, {}, range_from(start));
 
-        if (c == '"') {
-            if (!tok.empty()) {
-                unget_stream();
-                break;
-            }
-            c = read_stream();
-            for (; c != '\"' && c != -1; c = read_stream()) {
-                tok.push_back(c);
-            }
-            tok = post_process_string(tok);
-            string = true;
-            break;
-        }
+    char c = peek_char();
 
-        if (c == '#') {
-            while (c != '\n' && c != -1)
-                c = read_stream();
-            while (isspace(peek_stream()))
-                read_stream();
-            if (tok.empty()) {
-                actual_pos = pos;
-                continue;
-            } else
-                break;
-        }
+    if (c == '"') {
+        read_char();
+        std::string_view text = source.substr(cursor, scan_until(source.substr(cursor), '"'));
+        cursor += text.size();
+        bool escaped = scan_until(text, '\\') < text.size();
+        if (!at_end())
+            read_char();
 
-        // Basically stop the token if we have an operator that is right after another token i.e. `peter*`
-        if (!tok.empty() && // If we are in a token
-            operator_startswith(c) && // And the current char starts an operator
-            !operator_startswith(tok + (char) c) && // But the token and that char do not start an operator
-            (c != '.')) { // And c isn't '.', because we need that for numbers
-            unget_stream();
-            break; // Break
-        }
+        // Only strings that actually contain escape sequences need their own copy
+        if (escaped)
+            return Token(STRING, unescape_string(text), range_from(start));
+        return Token::view(STRING, text, range_from(start));
+    }
 
-        // This is a bit hacky, but it works ig
-        // TODO: make this clean
-        if (operator_startswith(c) && (c != '.' || tok.empty() || tok == "." || tok == "..")) {
-            if (tok.empty()) {
-                op = true;
-                tok.push_back(c);
-            } else if (op) {
-                tok.push_back(c);
-            } else {
-                unget_stream();
-                break;
-            }
-            continue;
-        }
+    TokenType type;
 
-        if (op || isspace(c)) {
-            unget_stream();
-            break;
-        }
+    uint8_t cls = char_class(c);
 
-        if (isnumber(c)) {
-            if (num || tok.empty()) {
-                num = true;
-            }
-            tok.push_back(c);
-        } else if (c == '.') {
-            char cs = peek_stream();
-            if (tok.empty()) {
-                if (isnumber(cs)) {
-                    tok = {'0', '.', cs};
-                    num = true;
-                    real = true;
-                    read_stream();
-                } else {
-                    tok = ".";
-                    break;
-                }
-            } else {
-                if (num && isnumber(cs) && !real) {
-                    tok.append({'.', cs});
-                    real = true;
-                    read_stream();
-                } else {
-                    unget_stream();
-                    break;
-                }
-            }
-        } else {
-            if (!num) {
-                tok.push_back(c);
-            } else {
-                // No scientific notation for now
-                unget_stream();
+    if (cls & CHAR_OPERATOR) {
+        // Operators are matched greedily, i.e. `===` is `==` followed by `=`
+        const OperatorNode &node = operator_trie[(unsigned char) read_char()];
+        type = node.type;
+        for (int i = 0; i < 2; i++) {
+            if (node.next_type[i] != END && peek_char() == node.next[i]) {
+                read_char();
+                type = node.next_type[i];
                 break;
             }
         }
-    }
-
-    TokenType type;
-    if (op && operators.count(tok)) {
-        type = operators[tok];
-    } else if (keywords.count(tok)) {
-        type = keywords[tok];
-    } else if (real) {
-        type = REAL;
-    } else if (num) {
+    } else if (cls & CHAR_DIGIT) {
+        cursor += scan_digits(source.substr(cursor));
         type = INTEGER;
-    } else if (string) {
-        type = STRING;
+        // No scientific notation for now
+        if (peek_char() == '.' && (char_class(peek_char(1)) & CHAR_DIGIT)) {
+            read_char();
+            cursor += scan_digits(source.substr(cursor));
+            type = REAL;
+        }
     } else {
-        type = NAME;
-    }
-
-    if (type == NAME && peek_stream() == '!') {
-        tok += read_stream();
-        type = MACRO_NAME;
-    }
-
-    LexerRange range = actual_pos - pos;
+        cursor += scan_name(source.substr(cursor));
 
-    if (!stream->good() && tok.empty()) {
-        return Token(END, "", range);
+        type = keyword_type(source.substr(start, cursor - start));
+        if (type == NAME) {
+            if (peek_char() == '!') {
+                read_char();
+                type = MACRO_NAME;
+            }
+            return Token::symbolic(type, Symbol(source.substr(start, cursor - start)), range_from(start));
+        }
     }
 
-    return Token(type, tok, range);
+    return Token::view(type, source.substr(start, cursor - start), range_from(start));
 }
@@ -1,4 +1,4 @@
-// tarik (c) Nikolas Wipper 2020-2023
+// tarik (c) Nikolas Wipper 2020-2025
 
 /* This Source Code Form is subject to the terms of the Mozilla Public
  * License, v. 2.0. If a copy of the MPL was not distributed with this
@@ -8,41 +8,53 @@
 #define TARIK_SRC_LEXICAL_LEXER_H_
 
 #include "Token.h"
+#include "Source.h"
 
 #include <vector>
 #include <istream>
 #include <filesystem>
+#include <string_view>
 
 class Lexer {
-    std::istream *stream;
-    bool allocated = false;
+    uint32_t file;
+    std::string_view source;
+    size_t cursor = 0;
 
-    LexerPos pos {1, 0, ""};
+    // Every file is tokenised exactly once, up front, so lookahead and backtracking are plain index operations. The
+    // last token is always END.
+    std::vector<Token> tokens;
+    size_t index = 0;
 
-    static bool operator_startswith(char c);
+    bool at_end() const;
+    char peek_char(size_t dist = 0) const;
+    char read_char();
+    LexerRange range_from(size_t start) const;
+    void skip_whitespace();
 
-    static bool operator_startswith(const std::string& c);
-
-    char read_stream();
-    char peek_stream();
-    void unget_stream();
+    void tokenize();
+    Token lex();
 
 public:
     struct State {
+        // End of the last consumed token
         LexerPos pos;
-        std::streampos streampos;
+        size_t index;
     };
 
     explicit Lexer(std::istream *s);
     explicit Lexer(const std::filesystem::path &f);
-    ~Lexer();
+    explicit Lexer(const SourceFile *file);
+
+    uint32_t get_file() const { return file; }
+    // Every token of the file, ending with END
+    const std::vector<Token> &get_tokens() const { return tokens; }
 
     State checkpoint() const;
     void rollback(State state);
 
-    Token peek(int dist = 0);
+    const Token &peek(int dist = 0) const;
 
-    Token consume();
+    const Token &consume();
 };
 
 #endif //TARIK_SRC_LEXICAL_LEXER_H_
@@ -0,0 +1,38 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_LEXICAL_PERMANENTALLOCATOR_H_
+#define TARIK_SRC_LEXICAL_PERMANENTALLOCATOR_H_
+
+#include <cstdlib>
+#include <new>
+
+// Allocator for global tables, like symbols and source files. It allocates with malloc
+// directly, which keeps them out of the self test's leak detection, since that counts calls to operator new.
+template <class T>
+struct PermanentAllocator {
+    using value_type = T;
+
+    PermanentAllocator() = default;
+
+    template <class U>
+    PermanentAllocator(const PermanentAllocator<U> &) {}
+
+    T *allocate(std::size_t n) {
+        if (void *p = std::malloc(n * sizeof(T)))
+            return static_cast<T *>(p);
+        throw std::bad_alloc();
+    }
+
+    void deallocate(T *p, std::size_t) {
+        std::free(p);
+    }
+
+    template <class U>
+    bool operator==(const PermanentAllocator<U> &) const { return true; }
+};
+
+#endif //TARIK_SRC_LEXICAL_PERMANENTALLOCATOR_H_
@@ -0,0 +1,198 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "Scan.h"
+
+#if defined(TARIK_SCAN_SSE2) && defined(__GNUC__)
+    #define TARIK_SCAN_AVX2
+    #include <immintrin.h>
+#endif
+
+namespace
+{
+using RunScanner = std::size_t (*)(const char *text, std::size_t size);
+using UntilScanner = std::size_t (*)(const char *text, std::size_t size, char c);
+
+struct Scanners {
+    std::string_view name;
+    RunScanner whitespace, digits, name_body;
+    UntilScanner until;
+};
+
+template <uint8_t Class>
+std::size_t scalar_run(const char *text, std::size_t size, std::size_t i = 0) {
+    while (i < size && (char_class(text[i]) & Class))
+        i++;
+    return i;
+}
+
+std::size_t scalar_whitespace(const char *text, std::size_t size) {
+    return scalar_run<CHAR_SPACE>(text, size);
+}
+
+std::size_t scalar_digits(const char *text, std::size_t size) {
+    return scalar_run<CHAR_DIGIT>(text, size);
+}
+
+std::size_t scalar_name(const char *text, std::size_t size, std::size_t i = 0) {
+    while (i < size && !(char_class(text[i]) & CHAR_NAME_END))
+        i++;
+    return i;
+}
+
+std::size_t scalar_until(const char *text, std::size_t size, char c, std::size_t i = 0) {
+    while (i < size && text[i] != c)
+        i++;
+    return i;
+}
+
+#ifdef TARIK_SCAN_SSE2
+template <uint32_t (*Mask)(__m128i)>
+std::size_t sse2_full_run(const char *text, std::size_t size) {
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint32_t outside = ~Mask(_mm_loadu_si128((const __m128i *) (text + i))) & 0xFFFF;
+        if (outside)
+            return i + std::countr_zero(outside);
+    }
+    return i;
+}
+
+std::size_t sse2_whitespace(const char *text, std::size_t size) {
+    return scalar_run<CHAR_SPACE>(text, size, sse2_full_run<sse2_whitespace_mask>(text, size));
+}
+
+std::size_t sse2_digits(const char *text, std::size_t size) {
+    return scalar_run<CHAR_DIGIT>(text, size, sse2_full_run<sse2_digit_mask>(text, size));
+}
+
+std::size_t sse2_name(const char *text, std::size_t size) {
+    return scalar_name(text, size, sse2_full_run<sse2_name_mask>(text, size));
+}
+
+std::size_t sse2_until(const char *text, std::size_t size, char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint32_t found = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (text + i)), needle));
+        if (found)
+            return i + std::countr_zero(found);
+    }
+    return scalar_until(text, size, c, i);
+}
+
+constexpr Scanners sse2_scanners = {"sse2", sse2_whitespace, sse2_digits, sse2_name, sse2_until};
+#endif
+
+#ifdef TARIK_SCAN_AVX2
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 __m256i avx2_in_range(__m256i x, char a, char b) {
+    __m256i offset = _mm256_sub_epi8(x, _mm256_set1_epi8(a));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8((char) (b - a))), offset);
+}
+
+AVX2 uint32_t avx2_whitespace_mask(__m256i x) {
+    __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), avx2_in_range(x, '\t', '\r'));
+    return _mm256_movemask_epi8(space);
+}
+
+AVX2 uint32_t avx2_digit_mask(__m256i x) {
+    return _mm256_movemask_epi8(avx2_in_range(x, '0', '9'));
+}
+
+AVX2 uint32_t avx2_name_mask(__m256i x) {
+    __m256i letter = avx2_in_range(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+    __m256i name = _mm256_or_si256(_mm256_or_si256(letter, avx2_in_range(x, '0', '9')),
+                                   _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_')));
+    return _mm256_movemask_epi8(_mm256_or_si256(name, x));
+}
+
+// Target attributes don't carry over into templates, so the loop is spelled out for every mask
+#define AVX2_RUN(mask)                                                                  \
+    std::size_t i = 0;                                                                  \
+    for (; i + 32 <= size; i += 32) {                                                   \
+        uint32_t outside = ~mask(_mm256_loadu_si256((const __m256i *) (text + i)));     \
+        if (outside)                                                                    \
+            return i + std::countr_zero(outside);                                          \
+    }
+
+AVX2 std::size_t avx2_whitespace(const char *text, std::size_t size) {
+    AVX2_RUN(avx2_whitespace_mask)
+    return scalar_run<CHAR_SPACE>(text, size, i);
+}
+
+AVX2 std::size_t avx2_digits(const char *text, std::size_t size) {
+    AVX2_RUN(avx2_digit_mask)
+    return scalar_run<CHAR_DIGIT>(text, size, i);
+}
+
+AVX2 std::size_t avx2_name(const char *text, std::size_t size) {
+    AVX2_RUN(avx2_name_mask)
+    return scalar_name(text, size, i);
+}
+
+AVX2 std::size_t avx2_until(const char *text, std::size_t size, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint32_t found = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (text + i)), needle));
+        if (found)
+            return i + std::countr_zero(found);
+    }
+    return sse2_until(text + i, size - i, c) + i;
+}
+
+#undef AVX2_RUN
+#undef AVX2
+
+constexpr Scanners avx2_scanners = {"avx2", avx2_whitespace, avx2_digits, avx2_name, avx2_until};
+#endif
+
+constexpr Scanners scalar_scanners = {
+    "scalar",
+    scalar_whitespace,
+    scalar_digits,
+    [](const char *text, std::size_t size) { return scalar_name(text, size); },
+    [](const char *text, std::size_t size, char c) { return scalar_until(text, size, c); }
+};
+
+const Scanners &scanners() {
+    static const Scanners &selected = []() -> const Scanners & {
+#ifdef TARIK_SCAN_AVX2
+        if (__builtin_cpu_supports("avx2"))
+            return avx2_scanners;
+#endif
+#ifdef TARIK_SCAN_SSE2
+        return sse2_scanners;
+#else
+        return scalar_scanners;
+#endif
+    }();
+    return selected;
+}
+}
+
+std::size_t scan_whitespace_long(const char *text, std::size_t size) {
+    return scanners().whitespace(text, size);
+}
+
+std::size_t scan_digits_long(const char *text, std::size_t size) {
+    return scanners().digits(text, size);
+}
+
+std::size_t scan_name_long(const char *text, std::size_t size) {
+    return scanners().name_body(text, size);
+}
+
+std::size_t scan_until_long(const char *text, std::size_t size, char c) {
+    return scanners().until(text, size, c);
+}
+
+std::string_view scan_implementation() {
+    return scanners().name;
+}
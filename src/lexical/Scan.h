@@ -0,0 +1,113 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_LEXICAL_SCAN_H_
+#define TARIK_SRC_LEXICAL_SCAN_H_
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "Token.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+    // SSE2 is part of x86-64, so it never has to be detected
+    #define TARIK_SCAN_SSE2
+    #include <emmintrin.h>
+#endif
+
+// Scanners for the runs of characters that make up most of a source file. Each returns the length of the run at the
+// start of text. The first 16 bytes are checked inline, longer runs go to an implementation picked for the CPU at
+// startup, which looks at 16 or 32 bytes at a time.
+
+// Dispatched implementations, only the scanners below should call these
+std::size_t scan_whitespace_long(const char *text, std::size_t size);
+std::size_t scan_digits_long(const char *text, std::size_t size);
+std::size_t scan_name_long(const char *text, std::size_t size);
+std::size_t scan_until_long(const char *text, std::size_t size, char c);
+
+#ifdef TARIK_SCAN_SSE2
+// The vector scanners build a bit mask of the bytes that belong to the run, and stop at the first zero bit. Names are
+// only matched on the characters they're usually made of (letters, digits, underscores and UTF-8), so the byte they
+// stop at is checked against the full character table.
+
+// a <= x <= b, for unsigned bytes
+inline __m128i sse2_in_range(__m128i x, char a, char b) {
+    __m128i offset = _mm_sub_epi8(x, _mm_set1_epi8(a));
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8((char) (b - a))), offset);
+}
+
+inline uint32_t sse2_whitespace_mask(__m128i x) {
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), sse2_in_range(x, '\t', '\r'));
+    return _mm_movemask_epi8(space);
+}
+
+inline uint32_t sse2_digit_mask(__m128i x) {
+    return _mm_movemask_epi8(sse2_in_range(x, '0', '9'));
+}
+
+inline uint32_t sse2_name_mask(__m128i x) {
+    __m128i letter = sse2_in_range(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i name = _mm_or_si128(_mm_or_si128(letter, sse2_in_range(x, '0', '9')),
+                                _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+    // Bytes with the high bit set are part of a multibyte UTF-8 character
+    return _mm_movemask_epi8(_mm_or_si128(name, x));
+}
+
+// Length of the run in the first 16 bytes, or 16 if it continues
+template <uint32_t (*Mask)(__m128i)>
+std::size_t sse2_run(const char *text) {
+    uint32_t outside = ~Mask(_mm_loadu_si128((const __m128i *) text)) & 0xFFFF;
+    return outside ? std::countr_zero(outside) : 16;
+}
+#endif
+
+// Whitespace, as classified by CHAR_SPACE
+inline std::size_t scan_whitespace(std::string_view text) {
+#ifdef TARIK_SCAN_SSE2
+    if (text.size() >= 16) {
+        std::size_t i = sse2_run<sse2_whitespace_mask>(text.data());
+        return i < 16 ? i : 16 + scan_whitespace_long(text.data() + 16, text.size() - 16);
+    }
+#endif
+    return scan_whitespace_long(text.data(), text.size());
+}
+
+// Decimal digits
+inline std::size_t scan_digits(std::string_view text) {
+#ifdef TARIK_SCAN_SSE2
+    if (text.size() >= 16) {
+        std::size_t i = sse2_run<sse2_digit_mask>(text.data());
+        return i < 16 ? i : 16 + scan_digits_long(text.data() + 16, text.size() - 16);
+    }
+#endif
+    return scan_digits_long(text.data(), text.size());
+}
+
+// Characters that don't end a name, i.e. anything without CHAR_NAME_END
+inline std::size_t scan_name(std::string_view text) {
+    std::size_t i = 0;
+#ifdef TARIK_SCAN_SSE2
+    if (text.size() >= 16)
+        i = sse2_run<sse2_name_mask>(text.data());
+    if (i == 16)
+        i += scan_name_long(text.data() + 16, text.size() - 16);
+#endif
+    while (i < text.size() && !(char_class(text[i]) & CHAR_NAME_END))
+        i += 1 + scan_name_long(text.data() + i + 1, text.size() - i - 1);
+    return i;
+}
+
+// Everything up to, but not including, the first c
+inline std::size_t scan_until(std::string_view text, char c) {
+    return scan_until_long(text.data(), text.size(), c);
+}
+
+// Name of the implementation picked for this CPU, for benchmarks
+std::string_view scan_implementation();
+
+#endif //TARIK_SRC_LEXICAL_SCAN_H_
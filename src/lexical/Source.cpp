@@ -0,0 +1,199 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "Source.h"
+
+#include "utf/Utf.h"
+
+#include <deque>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <shared_mutex>
+#include <unordered_map>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace
+{
+struct Files {
+    std::shared_mutex mutex;
+    std::deque<SourceFile, PermanentAllocator<SourceFile>> files;
+    std::unordered_map<Symbol,
+                       uint32_t,
+                       std::hash<Symbol>,
+                       std::equal_to<>,
+                       PermanentAllocator<std::pair<const Symbol, uint32_t>>> by_name;
+
+    Files() {
+        files.emplace_back(0, Symbol(), "", 0, SourceFile::Storage::NONE);
+    }
+};
+
+Files &files() {
+    static Files instance;
+    return instance;
+}
+
+const char *copy_contents(std::string_view contents) {
+    auto *data = static_cast<char *>(std::malloc(contents.size() + 1));
+    if (!data)
+        throw std::bad_alloc();
+    std::memcpy(data, contents.data(), contents.size());
+    data[contents.size()] = '\0';
+    return data;
+}
+
+bool read_file(const std::filesystem::path &file, const char *&data, std::size_t &size, SourceFile::Storage &storage) {
+#if !defined(_WIN32)
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st {};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            close(fd);
+            data = (const char *) map;
+            size = st.st_size;
+            storage = SourceFile::Storage::MAPPED;
+            return true;
+        }
+    }
+    close(fd);
+#endif
+
+    // Empty files can't be mapped, and some platforms don't have mmap at all
+    std::ifstream stream(file, std::ios::binary);
+    if (stream.fail())
+        return false;
+    std::string contents(std::istreambuf_iterator<char>(stream), {});
+    data = copy_contents(contents);
+    size = contents.size();
+    storage = SourceFile::Storage::HEAP;
+    return true;
+}
+
+const SourceFile *emplace_file(Symbol name, const char *data, std::size_t size, SourceFile::Storage storage) {
+    Files &f = files();
+    std::unique_lock lock(f.mutex);
+
+    SourceFile &file = f.files.emplace_back((uint32_t) f.files.size(), name, data, size, storage);
+    if (!name.empty())
+        f.by_name.insert_or_assign(name, file.get_id());
+    return &file;
+}
+}
+
+SourceFile::SourceFile(uint32_t id, Symbol name, const char *data, std::size_t size, Storage storage)
+    : id(id),
+      name(name),
+      data(data),
+      size(size),
+      storage(storage),
+      invalid_utf8(find_invalid_utf8(text())) {}
+
+SourceFile::~SourceFile() {
+#if !defined(_WIN32)
+    if (storage == Storage::MAPPED)
+        munmap((void *) data, size);
+#endif
+    if (storage == Storage::HEAP)
+        std::free((void *) data);
+}
+
+void SourceFile::build_lines() const {
+    std::call_once(lines_built,
+                   [this] {
+                       // Files that were only referenced are read now
+                       if (!data && !read_file(name.str(), data, size, storage))
+                           return;
+
+                       line_starts.push_back(0);
+                       for (std::size_t i = 0; i < size; i++) {
+                           if (data[i] == '\n')
+                               line_starts.push_back(i + 1);
+                       }
+                   });
+}
+
+int SourceFile::line(uint32_t offset) const {
+    build_lines();
+    if (line_starts.empty())
+        return 0;
+    return (int) (std::upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin());
+}
+
+int SourceFile::column(uint32_t offset) const {
+    int l = line(offset);
+    if (l == 0)
+        return 0;
+    return (int) (offset - line_starts[l - 1]) + 1;
+}
+
+uint32_t SourceFile::line_end(uint32_t offset) const {
+    int l = line(offset);
+    if (l == 0 || l == (int) line_starts.size())
+        return size;
+    return line_starts[l] - 1;
+}
+
+const SourceFile *SourceManager::load(const std::filesystem::path &file) {
+    const char *data;
+    std::size_t size;
+    SourceFile::Storage storage;
+    if (!read_file(file, data, size, storage))
+        return nullptr;
+    return emplace_file(Symbol(file.string()), data, size, storage);
+}
+
+const SourceFile *SourceManager::add(const std::filesystem::path &name, std::string_view contents) {
+    return emplace_file(Symbol(name.string()), copy_contents(contents), contents.size(), SourceFile::Storage::HEAP);
+}
+
+uint32_t SourceManager::reference(const std::filesystem::path &file) {
+    if (file.empty())
+        return 0;
+
+    Symbol name = Symbol(file.string());
+    {
+        Files &f = files();
+        std::shared_lock lock(f.mutex);
+        auto it = f.by_name.find(name);
+        if (it != f.by_name.end())
+            return it->second;
+    }
+    return emplace_file(name, nullptr, 0, SourceFile::Storage::NONE)->get_id();
+}
+
+SourceManager::Scope::Scope() {
+    Files &f = files();
+    std::shared_lock lock(f.mutex);
+    first = (uint32_t) f.files.size();
+}
+
+SourceManager::Scope::~Scope() {
+    Files &f = files();
+    std::unique_lock lock(f.mutex);
+
+    std::erase_if(f.by_name, [this](const auto &entry) { return entry.second >= first; });
+    while (f.files.size() > first)
+        f.files.pop_back();
+}
+
+const SourceFile &SourceManager::get(uint32_t id) {
+    Files &f = files();
+    std::shared_lock lock(f.mutex);
+    return f.files[id];
+}
@@ -0,0 +1,98 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_LEXICAL_SOURCE_H_
+#define TARIK_SRC_LEXICAL_SOURCE_H_
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#include "PermanentAllocator.h"
+#include "Symbol.h"
+
+// A source file known to the compiler. Files are memory mapped where the platform allows it, so that tokens can point
+// straight into the text instead of copying it.
+class SourceFile {
+    friend class SourceManager;
+
+public:
+    // Where the text lives, which decides how it's given back when the file is dropped
+    enum class Storage {
+        // Not owned, or not read yet
+        NONE,
+        MAPPED,
+        // Allocated with malloc
+        HEAP,
+    };
+
+private:
+    uint32_t id;
+    Symbol name;
+
+    mutable const char *data = nullptr;
+    mutable std::size_t size = 0;
+    mutable Storage storage;
+    std::size_t invalid_utf8;
+
+    // Start offset of every line, built the first time a diagnostic needs a line number
+    mutable std::once_flag lines_built;
+    mutable std::vector<uint32_t, PermanentAllocator<uint32_t>> line_starts;
+
+    void build_lines() const;
+
+public:
+    SourceFile(uint32_t id, Symbol name, const char *data, std::size_t size, Storage storage);
+    SourceFile(const SourceFile &) = delete;
+    SourceFile &operator=(const SourceFile &) = delete;
+    ~SourceFile();
+
+    uint32_t get_id() const { return id; }
+    // The name is always null-terminated
+    std::string_view get_name() const { return name.str(); }
+    std::string_view text() const { return {data, size}; }
+    // Offset of the first byte that isn't valid UTF-8, or npos. Files are validated once when they're loaded.
+    std::size_t get_invalid_utf8() const { return invalid_utf8; }
+
+    // 1-based line of a byte offset, or 0 if the file's contents aren't known
+    int line(uint32_t offset) const;
+    // 1-based column of a byte offset, or 0 if the file's contents aren't known
+    int column(uint32_t offset) const;
+    // Offset of the end of the line that contains offset
+    uint32_t line_end(uint32_t offset) const;
+};
+
+// Owns every source file of the compilation and hands out the small IDs that LexerRanges refer to. Files stay loaded
+// until the Scope they were registered in ends, because tokens and with them the AST point into their text. ID 0 is an
+// empty file without a name, used by ranges that don't point anywhere.
+class SourceManager {
+public:
+    // Drops every file registered while it exists, for drivers that compile more than one program. Nothing may refer
+    // to those files once it ends, including diagnostics. Scopes nest, and no other thread may register files while
+    // one ends.
+    class Scope {
+        uint32_t first;
+
+    public:
+        Scope();
+        Scope(const Scope &) = delete;
+        ~Scope();
+    };
+
+    // Returns nullptr and leaves errno set if the file couldn't be read
+    static const SourceFile *load(const std::filesystem::path &file);
+    // Register an in-memory buffer, the contents are copied
+    static const SourceFile *add(const std::filesystem::path &name, std::string_view contents);
+    // ID of a file that is referred to, for example by an imported library, but not lexed. Its contents are only
+    // read if a diagnostic needs a line number.
+    static uint32_t reference(const std::filesystem::path &file);
+
+    static const SourceFile &get(uint32_t id);
+};
+
+#endif //TARIK_SRC_LEXICAL_SOURCE_H_
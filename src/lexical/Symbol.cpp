@@ -0,0 +1,111 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "Symbol.h"
+
+#include "PermanentAllocator.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+class Interner {
+    static constexpr std::size_t CHUNK_BITS = 12;
+    static constexpr std::size_t CHUNK_SIZE = 1 << CHUNK_BITS;
+    static constexpr std::size_t MAX_CHUNKS = 1 << 16;
+    static constexpr std::size_t TEXT_BLOCK_SIZE = 64 * 1024;
+
+    std::shared_mutex mutex;
+    std::unordered_map<std::string_view,
+                       uint32_t,
+                       std::hash<std::string_view>,
+                       std::equal_to<>,
+                       PermanentAllocator<std::pair<const std::string_view, uint32_t>>> ids;
+
+    // Texts indexed by ID. Chunks never move once allocated, so they can be read without taking the lock.
+    std::array<std::atomic<std::string_view *>, MAX_CHUNKS> chunks {};
+    uint32_t next_id = 1;
+
+    char *text_block = nullptr;
+    std::size_t text_left = 0;
+
+    std::string_view store(std::string_view text) {
+        // Texts are null-terminated, so they can be handed to C APIs
+        std::size_t needed = text.size() + 1;
+        if (needed > text_left) {
+            std::size_t size = std::max(needed, TEXT_BLOCK_SIZE);
+            text_block = PermanentAllocator<char>().allocate(size);
+            text_left = size;
+        }
+        std::memcpy(text_block, text.data(), text.size());
+        text_block[text.size()] = '\0';
+        std::string_view stored(text_block, text.size());
+        text_block += needed;
+        text_left -= needed;
+        return stored;
+    }
+
+public:
+    Interner() {
+        chunks[0] = PermanentAllocator<std::string_view>().allocate(CHUNK_SIZE);
+        chunks[0].load()[0] = "";
+    }
+
+    uint32_t intern(std::string_view text) {
+        if (text.empty())
+            return 0;
+
+        {
+            std::shared_lock lock(mutex);
+            auto it = ids.find(text);
+            if (it != ids.end())
+                return it->second;
+        }
+
+        std::unique_lock lock(mutex);
+        // Another thread might have interned the same text in the meantime
+        auto it = ids.find(text);
+        if (it != ids.end())
+            return it->second;
+
+        uint32_t id = next_id++;
+        std::size_t chunk = id >> CHUNK_BITS;
+        if (chunk >= MAX_CHUNKS)
+            throw std::length_error("too many symbols");
+        if (!chunks[chunk].load(std::memory_order_relaxed))
+            chunks[chunk].store(PermanentAllocator<std::string_view>().allocate(CHUNK_SIZE),
+                                std::memory_order_release);
+
+        std::string_view stored = store(text);
+        chunks[chunk].load(std::memory_order_relaxed)[id & (CHUNK_SIZE - 1)] = stored;
+        ids.emplace(stored, id);
+        return id;
+    }
+
+    std::string_view text(uint32_t id) const {
+        return chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)[id & (CHUNK_SIZE - 1)];
+    }
+};
+
+Interner &interner() {
+    static Interner instance;
+    return instance;
+}
+}
+
+Symbol::Symbol(std::string_view text)
+    : id(interner().intern(text)) {}
+
+std::string_view Symbol::str() const {
+    return interner().text(id);
+}
@@ -0,0 +1,40 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_LEXICAL_SYMBOL_H_
+#define TARIK_SRC_LEXICAL_SYMBOL_H_
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+// An interned string. Every distinct text is stored once for the whole process and identified by a small integer, so
+// symbols compare and hash like integers. Interning is thread-safe. The text of a symbol is always null-terminated.
+class Symbol {
+    uint32_t id = 0;
+
+public:
+    // The empty string
+    Symbol() = default;
+    explicit Symbol(std::string_view text);
+
+    std::string_view str() const;
+
+    uint32_t get_id() const { return id; }
+    bool empty() const { return id == 0; }
+
+    bool operator==(const Symbol &other) const = default;
+    auto operator<=>(const Symbol &other) const = default;
+};
+
+template <>
+struct std::hash<Symbol> {
+    std::size_t operator()(const Symbol &s) const noexcept {
+        return s.get_id();
+    }
+};
+
+#endif //TARIK_SRC_LEXICAL_SYMBOL_H_
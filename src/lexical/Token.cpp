@@ -6,13 +6,15 @@
 
 #include "Token.h"
 
+#include "Source.h"
+
 std::string to_string(const TokenType &tt) {
     for (const auto &op : operators)
-        if (op.second == tt)
-            return "'" + op.first + "'";
+        if (op.type == tt)
+            return "'" + std::string(op.spelling) + "'";
     for (const auto &key : keywords)
-        if (key.second == tt)
-            return "'" + key.first + "'";
+        if (key.type == tt)
+            return "'" + std::string(key.spelling) + "'";
     if (tt == NAME)
         return "name";
     if (tt == STRING)
@@ -26,51 +28,38 @@ LexerRange LexerPos::as_zero_range() const {
     return LexerRange { *this, 0 };
 }
 
-LexerPos &LexerPos::operator--() {
-    if (p > 1)
-        p--;
-    else {
-        // ugh, ill accept the inaccuracy for now
-        // todo: make this accurate
-        p = 1;
-        l--;
-    }
-    return *this;
+int LexerPos::line() const {
+    return SourceManager::get(file).line(offset);
 }
 
-LexerRange LexerPos::operator-(LexerPos other) {
-    if (this->filename != other.filename || this->l != other.l) {
+int LexerPos::column() const {
+    return SourceManager::get(file).column(offset);
+}
+
+LexerRange LexerPos::operator-(LexerPos other) const {
+    if (this->file != other.file || other.offset < this->offset) {
         return {};
     }
 
-    return LexerRange { *this, other.p - this->p };
+    return LexerRange { *this, other.offset - this->offset };
 }
 
 LexerPos LexerRange::end() const {
-    return LexerPos { this->l, this->p + this->length, this->filename };
+    return LexerPos { this->file, this->offset + this->length };
 }
 
 LexerRange LexerRange::operator+(const LexerRange &other) const {
-    if (this->filename != other.filename || this->l != other.l) {
-        return {};
-    }
-
-    return LexerRange { *this, (other.p + other.length) - this->p };
+    return *this - other.end();
 }
 
 bool LexerRange::operator>(const LexerRange &other) const {
-    if (this->l > other.l) return true;
-    if (this->l < other.l) return false;
-
-    return (this->p + this->length) > other.p + other.length;
+    if (this->file != other.file)
+        return this->file > other.file;
+    if (this->offset != other.offset)
+        return this->offset > other.offset;
+    return this->end().offset > other.end().offset;
 }
 
 std::size_t std::hash<LexerRange>::operator()(const LexerRange &r) const noexcept {
-    std::size_t seed = 0;
-    seed += std::hash<int>{}(r.l);
-    seed += std::hash<int>{}(r.p);
-    seed += std::hash<int>{}(r.length);
-    seed += std::hash<std::filesystem::path>{}(r.filename);
-
-    return seed;
+    return std::hash<uint64_t> {}(((uint64_t) r.file << 32 | r.offset) ^ ((uint64_t) r.length << 40));
 }
@@ -7,11 +7,17 @@
 #ifndef TARIK_SRC_LEXICAL_TOKEN_H_
 #define TARIK_SRC_LEXICAL_TOKEN_H_
 
-#include <filesystem>
+#include <array>
+#include <memory>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 
+#include "Symbol.h"
+
 enum TokenType {
     END,
     INTEGER,
@@ -62,7 +68,14 @@ enum TokenType {
     USER_TYPE
 };
 
-inline std::unordered_map<std::string, TokenType> operators = {
+inline constexpr std::size_t TOKEN_TYPE_COUNT = USER_TYPE + 1;
+
+struct TokenSpelling {
+    std::string_view spelling;
+    TokenType type;
+};
+
+inline constexpr TokenSpelling operators[] = {
     {"+", PLUS},
     {"-", MINUS},
     {"*", ASTERISK},
@@ -91,7 +104,7 @@ inline std::unordered_map<std::string, TokenType> operators = {
     {"$", DOLLAR}
 };
 
-inline std::unordered_map<std::string, TokenType> keywords = {
+inline constexpr TokenSpelling keywords[] = {
     {"fn", FUNC},
     {"return", RETURN},
     {"if", IF},
@@ -119,24 +132,124 @@ inline std::unordered_map<std::string, TokenType> keywords = {
     {"void", TYPE},
 };
 
+// Character classes used by the lexer. A character can be in multiple classes.
+enum CharClass : uint8_t {
+    CHAR_SPACE = 1 << 0,
+    CHAR_DIGIT = 1 << 1,
+    // Starts an operator
+    CHAR_OPERATOR = 1 << 2,
+    // Ends a name, i.e. whitespace, string quotes, comments and operators
+    CHAR_NAME_END = 1 << 3,
+};
+
+inline constexpr std::array<uint8_t, 256> char_classes = [] {
+    std::array<uint8_t, 256> table {};
+    for (unsigned char c : std::string_view(" \t\n\v\f\r"))
+        table[c] |= CHAR_SPACE | CHAR_NAME_END;
+    for (unsigned char c = '0'; c <= '9'; c++)
+        table[c] |= CHAR_DIGIT;
+    for (const TokenSpelling &op : operators)
+        table[(unsigned char) op.spelling[0]] |= CHAR_OPERATOR | CHAR_NAME_END;
+    table['"'] |= CHAR_NAME_END;
+    table['#'] |= CHAR_NAME_END;
+    return table;
+}();
+
+constexpr uint8_t char_class(char c) {
+    return char_classes[(unsigned char) c];
+}
+
+// Operators are at most two characters long, so they are looked up with a two level trie indexed by character. Every
+// character has room for two continuations, which is more than the current operators need.
+struct OperatorNode {
+    TokenType type = END;
+    char next[2] = {};
+    TokenType next_type[2] = {END, END};
+};
+
+inline constexpr std::array<OperatorNode, 256> operator_trie = [] {
+    std::array<OperatorNode, 256> trie {};
+    for (const TokenSpelling &op : operators) {
+        OperatorNode &node = trie[(unsigned char) op.spelling[0]];
+        if (op.spelling.size() == 1) {
+            node.type = op.type;
+        } else {
+            int slot = node.next_type[0] == END ? 0 : 1;
+            node.next[slot] = op.spelling[1];
+            node.next_type[slot] = op.type;
+        }
+    }
+    return trie;
+}();
+
+consteval bool operator_trie_is_complete() {
+    for (const TokenSpelling &op : operators) {
+        const OperatorNode &node = operator_trie[(unsigned char) op.spelling[0]];
+        // Every prefix of an operator has to be an operator on its own
+        if (op.spelling.size() > 2 || node.type == END)
+            return false;
+        if (op.spelling.size() == 2 && !((node.next[0] == op.spelling[1] && node.next_type[0] == op.type) ||
+                                         (node.next[1] == op.spelling[1] && node.next_type[1] == op.type)))
+            return false;
+    }
+    return true;
+}
+
+static_assert(operator_trie_is_complete(), "operator doesn't fit into the operator trie");
+
+// Perfect hash over the keyword set. If a new keyword causes a collision, the static_assert below fails and the
+// constants need to be adjusted.
+constexpr size_t keyword_hash(std::string_view s) {
+    return (s.size() * 2 + (unsigned char) s.front() + (unsigned char) s.back() * 44) % 64;
+}
+
+inline constexpr std::array<TokenSpelling, 64> keyword_table = [] {
+    std::array<TokenSpelling, 64> table {};
+    for (const TokenSpelling &key : keywords)
+        table[keyword_hash(key.spelling)] = key;
+    return table;
+}();
+
+consteval bool keyword_hash_is_perfect() {
+    for (const TokenSpelling &key : keywords)
+        if (keyword_table[keyword_hash(key.spelling)].spelling != key.spelling)
+            return false;
+    return true;
+}
+
+static_assert(keyword_hash_is_perfect(), "keyword hash has collisions");
+
+// Type of the keyword spelled s, or NAME if s isn't a keyword
+constexpr TokenType keyword_type(std::string_view s) {
+    if (s.empty())
+        return NAME;
+    const TokenSpelling &entry = keyword_table[keyword_hash(s)];
+    return entry.spelling == s ? entry.type : NAME;
+}
+
 std::string to_string(const TokenType &tt);
 
 struct LexerRange;
 
+// A position in a file registered with the SourceManager. Lines and columns are only computed when they are needed,
+// usually for printing a diagnostic.
 struct LexerPos {
-    int l = 0, p = 0;
-    std::filesystem::path filename;
+    uint32_t file = 0;
+    uint32_t offset = 0;
 
     LexerRange as_zero_range() const;
 
-    LexerPos &operator--();
+    // 1-based, or 0 if the position doesn't belong to a file
+    int line() const;
+    int column() const;
+
     // range from pos1 to pos2
-    LexerRange operator-(LexerPos other);
+    LexerRange operator-(LexerPos other) const;
     bool operator==(const LexerPos &other) const = default;
 };
 
 struct LexerRange : LexerPos {
-    int length = 0;
+    uint32_t length = 0;
 
     LexerPos end() const;
 
@@ -145,25 +258,53 @@ struct LexerRange : LexerPos {
     bool operator==(const LexerRange &other) const = default;
 };
 
+static_assert(std::is_trivially_copyable_v<LexerRange>);
+
 template <>
 struct std::hash<LexerRange> {
     std::size_t operator()(const LexerRange &s) const noexcept;
 };
 
 class Token {
+    // Text that doesn't exist verbatim in any source buffer or the symbol table, i.e. string literals with escape
+    // sequences. Shared, so copying a token stays cheap.
+    std::shared_ptr<const std::string> storage;
+
 public:
     explicit Token(TokenType id, std::string s, LexerRange lp)
-        : id(id),
-          raw(std::move(s)),
+        : storage(std::make_shared<const std::string>(std::move(s))),
+          id(id),
+          raw(*storage),
           origin(std::move(lp)) {}
 
-    static Token name(std::string s, const LexerRange &lp) {
-        return Token(NAME, std::move(s), lp);
+    // Make a token that refers to text owned by someone else, usually a SourceFile
+    static Token view(TokenType id, std::string_view s, LexerRange lp) {
+        Token t(id, LexerRange(std::move(lp)));
+        t.raw = s;
+        return t;
+    }
+
+    // Make a token for an interned name. The text lives in the symbol table, so it never dangles.
+    static Token symbolic(TokenType id, Symbol symbol, LexerRange lp) {
+        Token t = view(id, symbol.str(), std::move(lp));
+        t.symbol = symbol;
+        return t;
+    }
+
+    static Token name(std::string_view s, const LexerRange &lp) {
+        return symbolic(NAME, Symbol(s), lp);
     }
 
     TokenType id;
-    std::string raw;
+    std::string_view raw;
+    // Interned text of names and macro names, empty for all other tokens
+    Symbol symbol;
     LexerRange origin;
+
+private:
+    Token(TokenType id, LexerRange lp)
+        : id(id),
+          origin(std::move(lp)) {}
 };
 
 #endif //TARIK_SRC_LEXICAL_TOKEN_H_
@@ -2,44 +2,188 @@
 
 #include "Analyser.h"
 
+#include "Arena.h"
+#include "ThreadPool.h"
 #include "Variable.h"
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <ranges>
+#include <thread>
 #include <utility>
 
 namespace lifetime
 {
 Analyser::Analyser(Bucket *bucket, ::Analyser *analyser)
     : bucket(bucket),
-      structures(analyser->structures),
-      declarations(analyser->func_decls) {
+      structures(analyser->declarations->structures),
+      declarations(analyser->declarations->func_decls),
+      functions(std::make_shared<std::unordered_map<Symbol, Function>>()) {
     for (const auto &func : declarations | std::views::values) {
-        functions.emplace(func->path.str(), Function {func});
+        functions->emplace(Symbol(func->path.str()), Function {func});
     }
 }
 
+Analyser::Analyser(Bucket *bucket, std::shared_ptr<std::unordered_map<Symbol, Function>> functions)
+    : bucket(bucket),
+      functions(std::move(functions)) {}
+
 void Analyser::analyse(const std::vector<aast::Statement *> &statements) {
+    Arena::Guard guard(arena);
+
     analyse_statements(statements);
-    verify_statements(statements);
 
-    if (bucket->get_error_count() > 0)
+    // Components come out callees first, so by the time a function is verified, everything it calls outside of its
+    // own component already has its final relations
+    verify_components(call_graph_components());
+}
+
+std::vector<std::vector<Function *>> Analyser::call_graph_components() {
+    ComponentSearch search;
+    for (auto *function : definitions) {
+        if (!search.indices.contains(function))
+            find_components(function, search);
+    }
+    return std::move(search.components);
+}
+
+void Analyser::find_components(Function *function, ComponentSearch &search) {
+    // Tarjan's algorithm, which finishes components in reverse topological order
+    std::size_t index = search.indices.size();
+    search.indices.emplace(function, std::make_pair(index, index));
+    search.stack.push_back(function);
+    search.on_stack.insert(function);
+
+    for (auto *callee : function->callees) {
+        if (!search.indices.contains(callee)) {
+            find_components(callee, search);
+            auto &low_link = search.indices.at(function).second;
+            low_link = std::min(low_link, search.indices.at(callee).second);
+        } else if (search.on_stack.contains(callee)) {
+            auto &low_link = search.indices.at(function).second;
+            low_link = std::min(low_link, search.indices.at(callee).first);
+        }
+    }
+
+    if (search.indices.at(function).second != index)
         return;
 
-    bool changed = false;
+    std::vector<Function *> &component = search.components.emplace_back();
+    Function *member;
     do {
-        for (auto [name, func] : functions) {
-            std::unordered_set<Function *> callers = func.callers;
-            func.callers.clear();
-            for (auto *caller : callers) {
-                std::size_t relation_count = caller->relations.size();
+        member = search.stack.back();
+        search.stack.pop_back();
+        search.on_stack.erase(member);
+
+        member->component = search.components.size();
+        component.push_back(member);
+    } while (member != function);
+    // Verify members in the order they were found in
+    std::ranges::reverse(component);
+}
 
-                verify_statement(caller->statement);
+void Analyser::verify_components(const std::vector<std::vector<Function *>> &components) {
+    if (components.empty())
+        return;
+
+    struct Task {
+        Arena arena;
+        Bucket bucket;
+        // Components this one calls into that aren't verified yet
+        std::atomic<std::size_t> waiting = 0;
+        std::vector<std::size_t> dependents;
+    };
+
+    std::vector<Task> tasks(components.size());
+    for (std::size_t c = 0; c < components.size(); c++) {
+        std::unordered_set<std::size_t> callees;
+        for (auto *function : components[c]) {
+            for (auto *callee : function->callees) {
+                // Component IDs start at one
+                std::size_t callee_component = callee->component - 1;
+                if (callee_component != c && callees.insert(callee_component).second) {
+                    tasks[callee_component].dependents.push_back(c);
+                    tasks[c].waiting++;
+                }
+            }
+        }
+    }
 
-                changed = changed || relation_count > caller->relations.size();
+    ThreadPool pool(std::min<std::size_t>(components.size(), std::thread::hardware_concurrency()));
+    // Each component only reads the relations of its callees, so it can start as soon as they are done
+    std::function<void(std::size_t)> submit = [&](std::size_t c) {
+        pool.submit([&, c] {
+            Task &task = tasks[c];
+            {
+                Arena::Guard guard(task.arena);
+                Analyser analyser(&task.bucket, functions);
+                analyser.verify_component(components[c]);
+            }
+            for (std::size_t dependent : task.dependents) {
+                if (--tasks[dependent].waiting == 0)
+                    submit(dependent);
             }
+        });
+    };
+
+    // Collect them first, finished tasks already start decrementing
+    std::vector<std::size_t> ready;
+    for (std::size_t c = 0; c < components.size(); c++) {
+        if (tasks[c].waiting == 0)
+            ready.push_back(c);
+    }
+    for (std::size_t c : ready)
+        submit(c);
+    pool.wait();
+
+    // Merge in the order of the call graph, regardless of which component finished first
+    for (Task &task : tasks) {
+        arena.merge(task.arena);
+        bucket->merge(task.bucket);
+    }
+}
+
+void Analyser::verify_component(const std::vector<Function *> &component) {
+    std::deque<Function *> worklist;
+    std::unordered_set<Function *> queued;
+
+    // Verify function, and queue its callers in this component if that taught it new relations. Callers in later
+    // components haven't been verified yet, so only those need another pass.
+    auto verify = [&](Function *function) {
+        std::size_t relation_count = function->relations.size();
+        Lifetime *return_type = function->return_type;
+
+        verify_function((aast::FuncStatement *) function->statement);
+
+        if (relation_count == function->relations.size() && return_type == function->return_type)
+            return;
+        for (auto *caller : function->callers) {
+            if (caller->component == function->component && queued.insert(caller).second)
+                worklist.push_back(caller);
         }
-    } while (changed);
+    };
+
+    // Every body is verified at least once, even if an earlier one had errors
+    for (auto *function : component) {
+        // Declarations without a body don't have anything to verify
+        if (function->statement->statement_type == aast::FUNC_STMT)
+            verify(function);
+    }
+
+    while (!worklist.empty()) {
+        // Verifying a function again would report its errors again
+        if (bucket->get_error_count() > 0)
+            return;
+
+        Function *function = worklist.front();
+        worklist.pop_front();
+        queued.erase(function);
+
+        verify(function);
+    }
 }
 
 void Analyser::analyse_statements(const std::vector<aast::Statement *> &statements) {
@@ -88,7 +232,7 @@ void Analyser::analyse_scope(aast::ScopeStatement *scope, bool dont_init_vars) {
 
     analyse_statements(scope->block);
 
-    std::map<std::string, VariableState *> current_scope = variables.back();
+    std::unordered_map<Symbol, VariableState *> current_scope = variables.back();
     variables.pop_back();
 
     // Go through all the variables created in this scope
@@ -101,10 +245,17 @@ void Analyser::analyse_scope(aast::ScopeStatement *scope, bool dont_init_vars) {
 }
 
 void Analyser::analyse_function(aast::FuncStatement *func) {
-    functions.emplace(func->path.str(), Function {func});
+    // Functions called so far, or declared at the top level, only have their declaration
+    Function &function = (*functions)[Symbol(func->path.str())];
+    function.statement = func;
+    definitions.push_back(&function);
+
+    // Local functions are analysed in the middle of the enclosing one
+    Function *enclosing_function = current_function;
+    std::size_t enclosing_index = statement_index;
 
     statement_index = 0;
-    current_function = &functions.at(func->path.str());
+    current_function = &function;
 
     variables.emplace_back();
 
@@ -123,6 +274,12 @@ void Analyser::analyse_function(aast::FuncStatement *func) {
             state->values[0] = LocalLifetime::static_(nullptr);
     }
 
+    // The function itself ends after its last statement
+    current_function->statement_positions.push_back(func->origin);
+
+    current_function = enclosing_function;
+    statement_index = enclosing_index;
+
     /*
     std::cout << "In " << func->path.str() << std::endl;
     for (const auto &[name, var] : current_function->variables) {
@@ -198,7 +355,8 @@ VariableState *Analyser::analyse_variable(aast::VariableStatement *var, bool arg
         for (auto *member : st->members) {
             auto *temp = new aast::VariableStatement(var->origin,
                                                      member->type,
-                                                     Token::name(var->name.raw + "." + member->name.raw,
+                                                     Token::name(std::string(var->name.raw) + "." +
+                                                                 std::string(member->name.raw),
                                                                  var->name.origin));
 
             VariableState *semantic_member = analyse_variable(temp, argument);
@@ -208,7 +366,7 @@ VariableState *Analyser::analyse_variable(aast::VariableStatement *var, bool arg
         state = new CompoundState(llt, statement_index, member_states);
     }
 
-    variables.back().emplace(var->name.raw, state);
+    variables.back().emplace(var->name.symbol, state);
     if (argument) {
         state->assigned(0);
     }
@@ -217,16 +375,23 @@ VariableState *Analyser::analyse_variable(aast::VariableStatement *var, bool arg
 }
 
 void Analyser::analyse_expression(aast::Expression *expression, int depth) {
-    analyse_statements(expression->prelude);
+    analyse_statements(expression->get_prelude());
     switch (expression->expression_type) {
     case aast::CALL_EXPR: {
         auto *ce = (aast::CallExpression *) expression;
 
+        // Local functions might be called before they're analysed
+        Function *callee = &(*functions)[Symbol(ce->callee->print())];
+        if (std::ranges::find(current_function->callees, callee) == current_function->callees.end()) {
+            current_function->callees.push_back(callee);
+            callee->callers.push_back(current_function);
+        }
+
         for (auto *argument : ce->arguments) {
             analyse_expression(argument);
-            if (argument->flattens_to_member_access() && !argument->type.is_copyable()) {
+            if (argument->flattens_to_member_access() && !argument->type->is_copyable()) {
                 // Move if variable has non-copyable type
-                get_variable(argument->flatten_to_member_access())->move(statement_index);
+                get_variable(Symbol(argument->flatten_to_member_access()))->move(statement_index);
             }
         }
         break;
@@ -244,12 +409,11 @@ void Analyser::analyse_expression(aast::Expression *expression, int depth) {
     case aast::MEM_ACC_EXPR: {
         auto *mae = (aast::BinaryExpression *) expression;
 
-        if (mae->left->type.pointer_level == 0) {
+        if (mae->left->type->pointer_level == 0) {
             analyse_expression(mae->left);
 
             auto *name = new aast::NameExpression(mae->origin, mae->flatten_to_member_access());
             analyse_expression(name);
-            delete name;
         } else {
             // Ignore depth of previous derefs
             analyse_expression(mae->left, 1);
@@ -270,8 +434,8 @@ void Analyser::analyse_expression(aast::Expression *expression, int depth) {
         auto *ae = (aast::BinaryExpression *) expression;
 
         if (ae->left->flattens_to_member_access() &&
-            !(ae->left->type.pointer_level > 0 && ae->left->expression_type == aast::MEM_ACC_EXPR)) {
-            get_variable(ae->left->flatten_to_member_access())->assigned(statement_index);
+            !(ae->left->type->pointer_level > 0 && ae->left->expression_type == aast::MEM_ACC_EXPR)) {
+            get_variable(Symbol(ae->left->flatten_to_member_access()))->assigned(statement_index);
         } else {
             // In normal expressions, variables don't create a new lifetime
             analyse_expression(ae->left);
@@ -281,7 +445,7 @@ void Analyser::analyse_expression(aast::Expression *expression, int depth) {
     }
     case aast::NAME_EXPR:
     case aast::VAR_EXPR: {
-        get_variable(expression->flatten_to_member_access())->used(statement_index, depth);
+        get_variable(Symbol(expression->flatten_to_member_access()))->used(statement_index, depth);
         break;
     }
     case aast::INT_EXPR:
@@ -309,7 +473,7 @@ void Analyser::verify_statement(aast::Statement *statement) {
         verify_scope((aast::ScopeStatement *) statement);
         break;
     case aast::FUNC_STMT:
-        verify_function((aast::FuncStatement *) statement);
+        // Functions are verified on their own, in the order of the call graph
         break;
     case aast::IF_STMT:
         verify_if((aast::IfStatement *) statement);
@@ -343,7 +507,7 @@ void Analyser::verify_scope(aast::ScopeStatement *scope) {
 
 void Analyser::verify_function(aast::FuncStatement *func) {
     statement_index = 1;
-    current_function = &functions.at(func->path.str());
+    current_function = &functions->at(Symbol(func->path.str()));
 
     verify_scope(func);
 }
@@ -386,7 +550,7 @@ void Analyser::verify_import(aast::ImportStatement *import_) {
 }
 
 Lifetime *Analyser::verify_expression(aast::Expression *expression, bool assigned) {
-    verify_statements(expression->prelude);
+    verify_statements(expression->get_prelude());
     switch (expression->expression_type) {
     case aast::CALL_EXPR: {
         auto *ce = (aast::CallExpression *) expression;
@@ -398,9 +562,7 @@ Lifetime *Analyser::verify_expression(aast::Expression *expression, bool assigne
             lifetimes.emplace_back(verify_expression(argument), argument);
 
         // Get the function to be called
-        Function &function = functions.at(ce->callee->print());
-
-        function.callers.emplace(current_function);
+        Function &function = functions->at(Symbol(ce->callee->print()));
 
         auto find_argument_index = [&function](const Lifetime *pointer) -> std::pair<int, int> {
             int index = 0;
@@ -419,44 +581,44 @@ Lifetime *Analyser::verify_expression(aast::Expression *expression, bool assigne
             return std::make_pair(-1, -1);
         };
 
-        for (const auto &[longer, relations] : function.relations) {
-            for (const auto &[shorter, relation_origin] : relations) {
-                auto a = find_argument_index(longer);
-                auto b = find_argument_index(shorter);
+        // Checking a recursive call can add relations to the function being called
+        for (std::size_t relation = 0; relation < function.relations.size(); relation++) {
+            auto [longer, shorter, relation_origin] = function.relations[relation];
+            auto a = find_argument_index(longer);
+            auto b = find_argument_index(shorter);
 
-                if (a.first == -1 || b.first == -1)
-                    continue;
+            if (a.first == -1 || b.first == -1)
+                continue;
 
-                auto [local_longer, longer_expression] = lifetimes[a.first];
-                auto [local_shorter, shorter_expression] = lifetimes[b.first];
+            auto [local_longer, longer_expression] = lifetimes[a.first];
+            auto [local_shorter, shorter_expression] = lifetimes[b.first];
 
-                for (int i = 0; i < a.second + 1; i++) {
-                    local_longer = local_longer->next;
-                    longer_expression = longer_expression->get_inner();
-                }
-
-                for (int i = 0; i < b.second + 1; i++) {
-                    local_shorter = local_shorter->next;
-                    shorter_expression = shorter_expression->get_inner();
-                }
+            for (int i = 0; i < a.second + 1; i++) {
+                local_longer = local_longer->next;
+                longer_expression = longer_expression->get_inner();
+            }
 
-                Error *error = bucket->error(longer_expression->origin, "value does not live long enough")
-                                     ->note(shorter_expression->origin,
-                                            "'{}' should live longer than '{}',...",
-                                            longer_expression->print(),
-                                            shorter_expression->print());
-                if (relation_origin.has_value())
-                    error->note(relation_origin.value(), "...because of its usage here,...");
-
-                // Todo: integrate this with print_lifetime_error
-                if (local_longer->is_local()) {
-                    auto *local_local_longer = (LocalLifetime *) local_longer;
-                    error->note(current_function->statement_positions[local_local_longer->death - 1],
-                                "...but it only lives until here");
-                }
+            for (int i = 0; i < b.second + 1; i++) {
+                local_shorter = local_shorter->next;
+                shorter_expression = shorter_expression->get_inner();
+            }
 
-                error->assert(is_within(local_shorter, local_longer, ce->origin));
+            Error *error = bucket->error(longer_expression->origin, "value does not live long enough")
+                                 ->note(shorter_expression->origin,
+                                        "'{}' should live longer than '{}',...",
+                                        longer_expression->print(),
+                                        shorter_expression->print());
+            if (relation_origin.has_value())
+                error->note(relation_origin.value(), "...because of its usage here,...");
+
+            // Todo: integrate this with print_lifetime_error
+            if (local_longer->is_local()) {
+                auto *local_local_longer = (LocalLifetime *) local_longer;
+                error->note(current_function->statement_positions[local_local_longer->death - 1],
+                            "...but it only lives until here");
             }
+
+            error->assert(is_within(local_shorter, local_longer, ce->origin));
         }
 
         if (function.return_type) {
@@ -489,10 +651,9 @@ Lifetime *Analyser::verify_expression(aast::Expression *expression, bool assigne
 
         Lifetime *lt = verify_expression(mae->left);
 
-        if (mae->left->type.pointer_level == 0) {
+        if (mae->left->type->pointer_level == 0) {
             auto *name = new aast::NameExpression(mae->origin, mae->flatten_to_member_access());
             lt = verify_expression(name);
-            delete name;
         }
 
         return lt;
@@ -528,11 +689,11 @@ Lifetime *Analyser::verify_expression(aast::Expression *expression, bool assigne
     }
     case aast::NAME_EXPR:
     case aast::VAR_EXPR: {
+        VariableState *var = current_function->variables.at(Symbol(expression->flatten_to_member_access()));
         if (assigned)
-            return current_function->variables.at(expression->flatten_to_member_access())->current(statement_index);
+            return var->current(statement_index);
         // Get timeframe, where this variable has a value, i.e. can be accessed by a pointer
-        return current_function->variables.at(expression->flatten_to_member_access())->current_continuous(
-            statement_index);
+        return var->current_continuous(statement_index);
     }
     case aast::INT_EXPR:
     case aast::BOOL_EXPR:
@@ -548,7 +709,7 @@ Lifetime *Analyser::verify_expression(aast::Expression *expression, bool assigne
     }
 }
 
-VariableState *Analyser::get_variable(std::string name) {
+VariableState *Analyser::get_variable(Symbol name) {
     for (auto &scope : variables) {
         if (scope.contains(name))
             return scope.at(name);
@@ -585,12 +746,12 @@ bool Analyser::is_within(Lifetime *inner, Lifetime *outer, LexerRange origin, bo
 
         return true;
     } else {
-        if (is_shorter(outer, inner, current_function->relations)) {
+        if (current_function->relations.outlives(inner, outer)) {
             return true;
-        } else if (is_shorter(inner, outer, current_function->relations)) {
+        } else if (current_function->relations.outlives(outer, inner)) {
             return false;
         } else {
-            current_function->relations[outer].emplace_back(inner, origin);
+            current_function->relations.add(outer, inner, origin);
             return true;
         }
     }
@@ -657,32 +818,4 @@ void Analyser::print_lifetime_error(Error *error,
         std::unreachable();
     }
 }
-
-bool Analyser::is_shorter(Lifetime *shorter,
-                          Lifetime *longer,
-                          std::map<Lifetime *, std::vector<std::pair<Lifetime *, std::optional<LexerRange>>>> relations)
-const {
-    // Perform DFS to see if there's a path from `a` to `b`
-    std::unordered_set<Lifetime *> visited;
-    std::stack<Lifetime *> stack;
-    stack.push(longer);
-
-    while (!stack.empty()) {
-        Lifetime *current = stack.top();
-        stack.pop();
-
-        if (current == shorter) {
-            return true;
-        }
-
-        for (const auto &[neighbor, origin] : relations[current]) {
-            if (!visited.contains(neighbor)) {
-                visited.insert(neighbor);
-                stack.push(neighbor);
-            }
-        }
-    }
-
-    return false;
-}
 } // lifetime
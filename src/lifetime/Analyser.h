@@ -3,14 +3,14 @@
 #ifndef TARIK_SRC_LIFETIME_ANALYSER_H_
 #define TARIK_SRC_LIFETIME_ANALYSER_H_
 
-#include <map>
-#include <optional>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "error/Bucket.h"
 #include "semantic/Analyser.h"
 #include "semantic/ast/Statements.h"
+#include "Relations.h"
 #include "Variable.h"
 
 namespace lifetime
@@ -24,23 +24,32 @@ struct Function {
     std::vector<Lifetime *> arguments;
     std::vector<LexerRange> statement_positions;
 
-    std::map<std::string, VariableState *> variables;
-    std::map<Lifetime *, std::vector<std::pair<Lifetime *, std::optional<LexerRange>>>> relations;
+    std::unordered_map<Symbol, VariableState *> variables;
+    Relations relations;
 
-    std::unordered_set<Function *> callers;
+    // Each in the order of their first call
+    std::vector<Function *> callers, callees;
+    // Strongly connected component of the call graph this function is part of
+    std::size_t component = 0;
 };
 
 class Analyser {
+    // Owns every lifetime and variable state of the analysis
+    Arena arena;
+
     Bucket *bucket;
     std::unordered_map<Path, aast::StructStatement *> structures;
     std::unordered_map<Path, aast::FuncDeclareStatement *> declarations;
 
-    // This should use Path instead of std::string, once function calls use PathExpressions as callees
-    std::unordered_map<std::string, Function> functions;
+    // This should use Path instead of the printed path, once function calls use PathExpressions as callees
+    // Shared with the analysers that verify components in parallel
+    std::shared_ptr<std::unordered_map<Symbol, Function>> functions;
+    // Functions with a body, in the order they were defined
+    std::vector<Function *> definitions;
 
     std::size_t statement_index = 0;
     Function *current_function = nullptr;
-    std::vector<std::map<std::string, VariableState *>> variables;
+    std::vector<std::unordered_map<Symbol, VariableState *>> variables;
 
 public:
     Analyser(Bucket *bucket, ::Analyser *analyser);
@@ -48,6 +57,8 @@ public:
     void analyse(const std::vector<aast::Statement *> &statements);
 
 private:
+    Analyser(Bucket *bucket, std::shared_ptr<std::unordered_map<Symbol, Function>> functions);
+
     void analyse_statements(const std::vector<aast::Statement *> &statements);
     void analyse_statement(aast::Statement *statement);
     void analyse_scope(aast::ScopeStatement *scope, bool dont_init_vars = false);
@@ -59,6 +70,19 @@ private:
     void analyse_import(aast::ImportStatement *import_);
     void analyse_expression(aast::Expression *expression, int depth = 0);
 
+    struct ComponentSearch {
+        // Discovery index and lowest reachable index of every visited function
+        std::unordered_map<Function *, std::pair<std::size_t, std::size_t>> indices;
+        std::vector<Function *> stack;
+        std::unordered_set<Function *> on_stack;
+        std::vector<std::vector<Function *>> components;
+    };
+
+    std::vector<std::vector<Function *>> call_graph_components();
+    void find_components(Function *function, ComponentSearch &search);
+    void verify_components(const std::vector<std::vector<Function *>> &components);
+    void verify_component(const std::vector<Function *> &component);
+
     void verify_statements(const std::vector<aast::Statement *> &statements);
     void verify_statement(aast::Statement *statement);
     void verify_scope(aast::ScopeStatement *scope);
@@ -69,7 +93,7 @@ private:
     void verify_import(aast::ImportStatement *import_);
     Lifetime *verify_expression(aast::Expression *expression, bool assigned = false);
 
-    VariableState *get_variable(std::string name);
+    VariableState *get_variable(Symbol name);
 
     bool is_within(Lifetime *inner, Lifetime *outer, LexerRange origin, bool rec = false) const;
     void print_lifetime_error(Error *error,
@@ -79,11 +103,6 @@ private:
                               Lifetime *outer,
                               bool rec =
                                       false) const;
-
-    bool is_shorter(Lifetime *shorter,
-                    Lifetime *longer,
-                    std::map<Lifetime *, std::vector<std::pair<Lifetime *, std::optional<LexerRange>>>> relations)
-    const;
 };
 } // lifetime
 
@@ -0,0 +1,56 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "Relations.h"
+
+namespace lifetime
+{
+bool Relations::test(const Bits &bits, uint32_t node) {
+    return node / 64 < bits.size() && (bits[node / 64] >> (node % 64) & 1);
+}
+
+uint32_t Relations::node(Lifetime *lifetime) {
+    auto [it, inserted] = nodes.try_emplace(lifetime, nodes.size());
+    if (inserted)
+        outlived.emplace_back();
+    return it->second;
+}
+
+void Relations::add(Lifetime *longer, Lifetime *shorter, std::optional<LexerRange> origin) {
+    relations.push_back({longer, shorter, origin});
+
+    uint32_t from = node(longer);
+    uint32_t to = node(shorter);
+
+    // Everything that outlives longer now also outlives shorter and whatever shorter outlives
+    Bits added = outlived[to];
+    if (to / 64 >= added.size())
+        added.resize(to / 64 + 1);
+    added[to / 64] |= uint64_t(1) << (to % 64);
+
+    for (uint32_t i = 0; i < outlived.size(); i++) {
+        if (i != from && !test(outlived[i], from))
+            continue;
+
+        Bits &bits = outlived[i];
+        if (bits.size() < added.size())
+            bits.resize(added.size());
+        for (std::size_t j = 0; j < added.size(); j++)
+            bits[j] |= added[j];
+    }
+}
+
+bool Relations::outlives(Lifetime *longer, Lifetime *shorter) const {
+    if (longer == shorter)
+        return true;
+
+    auto from = nodes.find(longer);
+    auto to = nodes.find(shorter);
+    if (from == nodes.end() || to == nodes.end())
+        return false;
+    return test(outlived[from->second], to->second);
+}
+} // lifetime
@@ -0,0 +1,59 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_LIFETIME_RELATIONS_H
+#define TARIK_SRC_LIFETIME_RELATIONS_H
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "lexical/Token.h"
+#include "Variable.h"
+
+namespace lifetime
+{
+// The "outlives" relations a function requires between the lifetimes of its arguments. Next to the relations
+// themselves, every lifetime keeps a bitset of all lifetimes it transitively outlives, which is updated as relations
+// are added. That makes queries a lookup, at the cost of touching every lifetime that outlives the new relation's
+// longer side when adding one.
+class Relations {
+public:
+    struct Relation {
+        Lifetime *longer;
+        Lifetime *shorter;
+        std::optional<LexerRange> origin;
+    };
+
+private:
+    using Bits = std::vector<uint64_t>;
+
+    std::vector<Relation> relations;
+    std::unordered_map<Lifetime *, uint32_t> nodes;
+    // Bit j of outlived[i] is set, if node i outlives node j
+    std::vector<Bits> outlived;
+
+    static bool test(const Bits &bits, uint32_t node);
+
+    uint32_t node(Lifetime *lifetime);
+
+public:
+    // Require that longer outlives shorter
+    void add(Lifetime *longer, Lifetime *shorter, std::optional<LexerRange> origin);
+    // Whether longer outlives shorter through any chain of relations. Every lifetime outlives itself.
+    bool outlives(Lifetime *longer, Lifetime *shorter) const;
+
+    std::size_t size() const { return relations.size(); }
+
+    // All relations, in the order they were added
+    auto begin() const { return relations.begin(); }
+    auto end() const { return relations.end(); }
+    const Relation &operator[](std::size_t index) const { return relations[index]; }
+};
+} // lifetime
+
+#endif //TARIK_SRC_LIFETIME_RELATIONS_H
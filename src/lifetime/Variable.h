@@ -6,13 +6,21 @@
 #include <cstddef>
 #include <vector>
 
+#include "Arena.h"
+
 namespace lifetime
 {
+// Lifetimes and variable states live in the Arena that is current while they are created, the analyser releases them
+// all at once when it's destroyed.
 struct Lifetime {
     Lifetime *next = nullptr;
 
     explicit Lifetime(Lifetime *next);
 
+    // Lifetimes don't own anything, so they are never destroyed, only released
+    static void *operator new(std::size_t size) { return Arena::current().allocate(size); }
+    static void operator delete(void *) {}
+
     virtual bool is_temp() const { return false; }
     virtual bool is_local() const { return false; }
 };
@@ -42,6 +50,16 @@ struct VariableState {
     std::vector<LocalLifetime *> values;
 
     VariableState(LocalLifetime *type, std::size_t at);
+    VariableState(const VariableState &) = delete;
+    virtual ~VariableState() = default;
+
+    // Registered for destruction with the memory, a state whose constructor throws is dropped again in operator delete
+    static void *operator new(std::size_t size) {
+        return Arena::current().allocate_finalized(size, [](void *state) {
+            static_cast<VariableState *>(state)->~VariableState();
+        });
+    }
+    static void operator delete(void *state) { Arena::cancel_release(state); }
 
     virtual void used(std::size_t at, int depth);
     virtual void assigned(std::size_t at);
@@ -4,12 +4,12 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
 
-#include "comperr.h"
-
+#include "cfg/Lowering.h"
 #include "cli/Arguments.h"
 #include "codegen/LLVM.h"
 #include "lifetime/Analyser.h"
 #include "semantic/Analyser.h"
+#include "semantic/Folding.h"
 #include "syntactic/Parser.h"
 #include "Version.h"
 
@@ -17,13 +17,19 @@
 #include <iostream>
 #include <filesystem>
 
+#include "Arena.h"
 #include "System.h"
 #include "tlib/Export.h"
 #include "tlib/Import.h"
+#include "tlib/ModuleCache.h"
 
 namespace fs = std::filesystem;
 
 int main(int argc, const char *argv[]) {
+    // Owns the syntax trees of libraries and sources alike
+    Arena arena;
+    Arena::Guard arena_guard(arena);
+
     ArgumentParser parser(argc, argv, "tarik");
 
     // Code Analsis
@@ -32,6 +38,10 @@ int main(int argc, const char *argv[]) {
                                             "Import declarations from a .tlib file",
                                             "path",
                                             'I');
+    Option *module_cache_option = parser.add_option("module-cache",
+                                                    "Code Analysis",
+                                                    "Cache parsed local imports in directory",
+                                                    "directory");
 
     // Code Generation
     Option *code_model = parser.add_option("Ccode-model", "Code Generation", "Set the code model", "model");
@@ -56,6 +66,7 @@ int main(int argc, const char *argv[]) {
                                             "Output",
                                             "Add type to the list of emitted output.\n"
                                             " - asm - name.s - Assembly code\n"
+                                            " - cfg - name.cfg - Control flow graphs of all functions\n"
                                             " - lib - name.tlib - Library metadata\n"
                                             " - llvm - name.ll - LLVM IR\n"
                                             " - obj - name.o - Object file\n"
@@ -70,8 +81,10 @@ int main(int argc, const char *argv[]) {
                                               'o');
 
     LLVM::Config config;
-    bool emit_aast = false, emit_ast = false, emit_asm = false, emit_llvm = false, emit_obj = false, emit_lib = false;
+    bool emit_aast = false, emit_ast = false, emit_asm = false, emit_cfg = false, emit_llvm = false, emit_obj = false,
+         emit_lib = false;
     std::string output_filename;
+    std::optional<ModuleCache> module_cache;
     std::unordered_map<std::string, std::vector<aast::Statement *>> libraries;
 
     for (const auto &option : parser) {
@@ -84,6 +97,8 @@ int main(int argc, const char *argv[]) {
             }
             lift_up_undefined(statements, Path({input.stem()}, {}));
             libraries.emplace(input.stem(), statements);
+        } else if (option == module_cache_option) {
+            module_cache.emplace(option.argument);
         } else if (option == code_model) {
             if (option.argument == "tiny")
                 config.code_model = llvm::CodeModel::Tiny;
@@ -131,6 +146,8 @@ int main(int argc, const char *argv[]) {
                 emit_ast = true;
             else if (option.argument == "asm")
                 emit_asm = true;
+            else if (option.argument == "cfg")
+                emit_cfg = true;
             else if (option.argument == "lib")
                 emit_lib = true;
             else if (option.argument == "llvm")
@@ -160,33 +177,27 @@ int main(int argc, const char *argv[]) {
         return 1;
     }
 
-    fs::path aast_path, ast_path, asm_path, llvm_path, obj_path, lib_path;
+    fs::path aast_path, ast_path, asm_path, cfg_path, llvm_path, obj_path, lib_path;
     if (output_filename.empty()) {
-        aast_path = ast_path = asm_path = llvm_path = obj_path = lib_path = input_path;
+        aast_path = ast_path = asm_path = cfg_path = llvm_path = obj_path = lib_path = input_path;
     } else {
-        aast_path = ast_path = asm_path = llvm_path = obj_path = lib_path = output_filename;
+        aast_path = ast_path = asm_path = cfg_path = llvm_path = obj_path = lib_path = output_filename;
     }
 
     aast_path.replace_extension(".sem.tk");
     ast_path.replace_extension(".syn.tk");
     asm_path.replace_extension(".s");
+    cfg_path.replace_extension(".cfg");
     llvm_path.replace_extension(".ll");
     obj_path.replace_extension(".o");
     lib_path.replace_extension(".tlib");
 
-    std::filesystem::path wd = std::filesystem::current_path();
-    std::filesystem::current_path(input_path.parent_path());
-
     Bucket error_bucket;
-    Parser p(input_path.filename(), &error_bucket);
+    Parser p(input_path, &error_bucket);
+    if (module_cache)
+        p.set_module_cache(&module_cache.value());
 
-    std::vector<ast::Statement *> statements;
-    do {
-        statements.push_back(p.parse_statement());
-    } while (statements.back());
-    statements.pop_back();
-
-    std::filesystem::current_path(wd);
+    std::vector<ast::Statement *> statements = p.parse();
 
     int result = 0;
     if (emit_ast) {
@@ -206,6 +217,8 @@ int main(int argc, const char *argv[]) {
             lifetime::Analyser lifetime_analyser(&error_bucket, &analyser);
             lifetime_analyser.analyse(analysed_statements);
         }
+        if (error_bucket.get_error_count() == 0)
+            fold_statements(analysed_statements);
     }
 
     if (error_bucket.get_error_count() == 0) {
@@ -216,6 +229,12 @@ int main(int argc, const char *argv[]) {
             }
             out.put('\n');
         }
+        if (emit_cfg) {
+            std::ofstream out(cfg_path);
+            for (const auto &function : cfg::lower(analysed_statements)) {
+                out << function.print() << "\n\n";
+            }
+        }
         if (emit_lib) {
             Export exporter;
             exporter.generate_statements(analysed_statements);
@@ -238,9 +257,8 @@ int main(int argc, const char *argv[]) {
         }
     }
 
-    std::for_each(analysed_statements.begin(), analysed_statements.end(), [](auto &p) { delete p; });
-    std::for_each(statements.begin(), statements.end(), [](auto &p) { delete p; });
+    arena.release();
     error_bucket.print_errors();
 
-    return endfile() ? result : 1;
+    return error_bucket.get_error_count() == 0 ? result : 1;
 }
@@ -9,7 +9,10 @@
 #include <algorithm>
 #include <iostream>
 #include <ranges>
+#include <thread>
 
+#include "Arena.h"
+#include "ThreadPool.h"
 #include "error/Error.h"
 #include "Path.h"
 #include "semantic/ast/Expression.h"
@@ -17,21 +20,27 @@
 #include "Variables.h"
 
 Analyser::Analyser(Bucket *bucket, std::unordered_map<std::string, std::vector<aast::Statement *>> libraries)
-    : macros({
-          {"as!", new CastMacro()},
-          {"extern!", new ExternMacro<false>()},
-          {"extern_va!", new ExternMacro<true>()}
-      }),
-      libraries(libraries),
+    : declarations(std::make_shared<Declarations>()),
+      bucket(bucket) {
+    declarations->macros = {
+        {"as!", new CastMacro()},
+        {"extern!", new ExternMacro<false>()},
+        {"extern_va!", new ExternMacro<true>()}
+    };
+    declarations->libraries = std::move(libraries);
+}
+
+Analyser::Analyser(std::shared_ptr<Declarations> declarations, Bucket *bucket)
+    : declarations(std::move(declarations)),
       bucket(bucket) {}
 
 std::vector<aast::Statement *> Analyser::finish() {
     std::vector<aast::Statement *> res;
-    res.reserve(structures.size() + func_decls.size() + functions.size());
-    for (auto decl : structure_graph.flatten())
-        res.push_back(structures[decl->path]);
+    res.reserve(declarations->structures.size() + declarations->func_decls.size() + functions.size());
+    for (auto decl : declarations->structure_graph.flatten())
+        res.push_back(declarations->structures[decl->path]);
 
-    for (auto [_, dc] : func_decls)
+    for (auto [_, dc] : declarations->func_decls)
         res.push_back(dc);
     for (auto *fn : functions)
         res.push_back(fn);
@@ -42,6 +51,7 @@ void Analyser::analyse(const std::vector<ast::Statement *> &statements) {
     analyse_import(statements);
     verify_structs(statements);
     verify_statements(statements);
+    verify_functions();
 }
 
 void Analyser::analyse_import(const std::vector<ast::Statement *> &statements) {
@@ -50,9 +60,9 @@ void Analyser::analyse_import(const std::vector<ast::Statement *> &statements) {
             auto *func = (ast::FuncStatement *) (statement);
             Path name = Path({}, LexerRange());
             if (func->member_of.has_value()) {
-                name = func->member_of.value().get_path().with_prefix(path).create_member(func->name.raw);
+                name = func->member_of.value().get_path().with_prefix(path).create_member(std::string(func->name.raw));
             } else {
-                name = path.create_member(func->name);
+                name = path.create_member(std::string(func->name.raw));
             }
 
             std::vector<aast::VariableStatement *> arguments;
@@ -62,19 +72,19 @@ void Analyser::analyse_import(const std::vector<ast::Statement *> &statements) {
                 arguments.push_back(new aast::VariableStatement(var->origin, var->type, var->name));
             }
 
-            func_decls.emplace(name,
-                               new aast::FuncDeclareStatement(statement->origin,
-                                                              name,
-                                                              std::string(),
-                                                              func->return_type,
-                                                              arguments,
-                                                              false));
+            declarations->add_func_decl(name,
+                                        new aast::FuncDeclareStatement(statement->origin,
+                                                                       name,
+                                                                       std::string(),
+                                                                       func->return_type,
+                                                                       arguments,
+                                                                       false));
         } else if (statement->statement_type == ast::STRUCT_STMT) {
             auto *struct_ = (ast::StructStatement *) statement;
 
             Path name = path.create_member(struct_->name);
 
-            struct_decls.emplace(name, new aast::StructDeclareStatement(statement->origin, name));
+            declarations->struct_decls.emplace(name, new aast::StructDeclareStatement(statement->origin, name));
         } else if (statement->statement_type == ast::IMPORT_STMT) {
             auto *import_ = (ast::ImportStatement *) statement;
 
@@ -87,20 +97,20 @@ void Analyser::analyse_import(const std::vector<ast::Statement *> &statements) {
                 if (!bucket->error(import_->path.origin,
                                    "tried to import '{}', but file can't be found",
                                    import_->path.str())
-                           ->assert(libraries.contains(import_->path.str()))) {
+                           ->assert(declarations->libraries.contains(import_->path.str()))) {
                     continue;
                 }
-                std::vector<aast::Statement *> &statements = libraries.at(import_->path.str());
+                std::vector<aast::Statement *> &statements = declarations->libraries.at(import_->path.str());
                 for (auto *statement : statements) {
                     if (statement->statement_type == aast::FUNC_DECL_STMT) {
                         auto *fd = (aast::FuncDeclareStatement *) statement;
-                        func_decls.emplace(fd->path, fd);
+                        declarations->add_func_decl(fd->path, fd);
                     } else if (statement->statement_type == aast::STRUCT_STMT) {
                         auto *sd = (aast::StructStatement *) statement;
-                        struct_decls.emplace(sd->path, sd);
-                        structures.emplace(sd->path, sd);
+                        declarations->struct_decls.emplace(sd->path, sd);
+                        declarations->structures.emplace(sd->path, sd);
                         // Can't have cyclic dependencies between packages, so don't bother adding fields
-                        structure_graph.get_node(sd);
+                        declarations->structure_graph.get_node(sd);
                     }
                 }
             }
@@ -164,7 +174,8 @@ std::optional<aast::Statement *> Analyser::verify_statement(ast::Statement *stat
     case ast::SCOPE_STMT:
         return verify_scope((ast::ScopeStatement *) statement);
     case ast::FUNC_STMT:
-        return verify_function((ast::FuncStatement *) statement);
+        queue_function((ast::FuncStatement *) statement);
+        break;
     case ast::IF_STMT:
         return verify_if((ast::IfStatement *) statement);
     case ast::ELSE_STMT:
@@ -207,13 +218,8 @@ std::optional<std::vector<aast::Statement *>> Analyser::verify_statements(
 }
 
 std::optional<aast::ScopeStatement *> Analyser::verify_scope(ast::ScopeStatement *scope, const std::string &name) {
-    size_t old_var_count = variables.size();
-
-    for (auto *var : variables) {
-        var->push_state(*var->state());
-        if (var->state()->is_definitely_defined())
-            var->state()->make_definitely_read();
-    }
+    states.push_scope();
+    variables.push_scope();
 
     path = path.create_member(name);
 
@@ -223,24 +229,11 @@ std::optional<aast::ScopeStatement *> Analyser::verify_scope(ast::ScopeStatement
 
     level--;
 
-    while (old_var_count < variables.size())
-        variables.pop_back();
+    variables.pop_scope();
 
     // todo: for loops this doesn't catch all cases where defines at the start immediately follow defines at the end
-    for (auto *var : variables) {
-        VariableState old_definite_state = *var->state();
-        var->pop_state();
-
-        if (scope->statement_type == ast::SCOPE_STMT) {
-            // plain scopes are always executed, so the old state is the new one
-            var->pop_state();
-            var->push_state(old_definite_state);
-        } else {
-            VariableState new_definite_state = *var->state() || old_definite_state;
-            var->pop_state();
-            var->push_state(new_definite_state);
-        }
-    }
+    // plain scopes are always executed, so the state at their end is the new one
+    states.pop_scope(scope->statement_type == ast::SCOPE_STMT);
 
     path = path.get_parent();
 
@@ -282,27 +275,82 @@ std::optional<aast::ScopeStatement *> Analyser::verify_scope(ast::ScopeStatement
         return {};
 }
 
-std::optional<aast::FuncStatement *> Analyser::verify_function(ast::FuncStatement *func) {
-    variables.clear();
-    variable_names.clear();
-    used_names.clear();
-    last_loop = nullptr; // this shouldn't do anything, but just to be sure
-
+void Analyser::queue_function(ast::FuncStatement *func) {
     if (func->member_of.has_value())
         verify_type(func->member_of.value());
 
     Path func_path = Path({}, LexerRange());
     if (func->member_of.has_value()) {
-        func_path = func->member_of.value().get_path().with_prefix(path).create_member(func->name.raw);
+        func_path = func->member_of.value().get_path().with_prefix(path).create_member(std::string(func->name.raw));
     } else {
-        func_path = path.create_member(func->name);
+        func_path = path.create_member(std::string(func->name.raw));
     }
 
-    for (auto *registered : functions) {
+    if (auto it = defined_functions.find(func_path); it != defined_functions.end()) {
         bucket->error(func->name.origin, "redefinition of '{}'", func->name.raw)
-              ->note(registered->path.origin, "previous definition here")
-              ->assert(func_path != registered->path);
+              ->note(it->second->name.origin, "previous definition here")
+              ->assert(false);
+        return;
     }
+    defined_functions.emplace(func_path, func);
+
+    pending_functions.push_back({func, path, func_path});
+}
+
+void Analyser::verify_functions() {
+    if (pending_functions.empty())
+        return;
+
+    struct Batch {
+        Arena arena;
+        Bucket bucket;
+        std::vector<aast::FuncStatement *> functions;
+        std::unordered_map<Path, aast::FuncDeclareStatement *> func_decls;
+    };
+
+    ThreadPool pool(std::min<std::size_t>(pending_functions.size(), std::thread::hardware_concurrency()));
+    // A few batches per thread even out functions of different sizes. Batches are contiguous, so merging them in
+    // order keeps functions in source order. Diagnostics are ordered by the bucket, which interleaves them with those
+    // of the declaration pass.
+    std::size_t batch_count = std::min(pending_functions.size(), pool.size() * 4);
+    std::vector<Batch> batches(batch_count);
+
+    for (std::size_t b = 0; b < batch_count; b++) {
+        pool.submit([this, &batch = batches[b], begin = pending_functions.size() * b / batch_count,
+                        end = pending_functions.size() * (b + 1) / batch_count] {
+            Arena::Guard guard(batch.arena);
+            Analyser analyser(declarations, &batch.bucket);
+
+            for (std::size_t i = begin; i < end; i++) {
+                analyser.path = pending_functions[i].module_path;
+                std::optional func = analyser.verify_function(pending_functions[i].func, pending_functions[i].path);
+                if (func.has_value())
+                    batch.functions.push_back(func.value());
+
+                // Functions declared in a body are only visible in that body until all bodies are verified, so what
+                // a function can call doesn't depend on which functions share its batch
+                batch.func_decls.insert(analyser.local_func_decls.begin(), analyser.local_func_decls.end());
+                analyser.local_func_decls.clear();
+            }
+        });
+    }
+    pool.wait();
+
+    for (Batch &batch : batches) {
+        Arena::current().merge(batch.arena);
+        bucket->merge(batch.bucket);
+        functions.insert(functions.end(), batch.functions.begin(), batch.functions.end());
+        declarations->func_decls.insert(batch.func_decls.begin(), batch.func_decls.end());
+    }
+    pending_functions.clear();
+}
+
+std::optional<aast::FuncStatement *> Analyser::verify_function(ast::FuncStatement *func, const Path &func_path) {
+    variables.clear();
+    unique_variables.clear();
+    states.clear();
+    used_names.clear();
+    last_loop = nullptr; // this shouldn't do anything, but just to be sure
 
     bucket->error(func->origin, "function with return type doesn't always return")
           ->assert(func->return_type == Type(VOID) || does_always_return(func));
@@ -312,7 +360,7 @@ std::optional<aast::FuncStatement *> Analyser::verify_function(ast::FuncStatemen
         std::optional sem = verify_variable(arg);
 
         if (sem.has_value()) {
-            sem.value()->state()->make_definitely_defined(arg->origin);
+            states.make_definitely_defined(sem.value(), arg->origin);
 
             arguments.push_back(sem.value()->var);
         }
@@ -323,19 +371,16 @@ std::optional<aast::FuncStatement *> Analyser::verify_function(ast::FuncStatemen
     if (!return_type.has_value())
         return {};
     this->return_type = return_type.value();
-    std::optional scope = verify_scope(func, func->name.raw);
+    std::optional scope = verify_scope(func, std::string(func->name.raw));
     if (!scope.has_value())
         return {};
     std::vector block = std::move(scope.value()->block);
-    delete scope.value();
-    functions.push_back(new aast::FuncStatement(func->origin,
-                                                func_path,
-                                                return_type.value(),
-                                                arguments,
-                                                std::move(block),
-                                                false));
-
-    return functions.back();
+    return new aast::FuncStatement(func->origin,
+                                   func_path,
+                                   return_type.value(),
+                                   arguments,
+                                   std::move(block),
+                                   false);
 }
 
 std::optional<aast::IfStatement *> Analyser::verify_if(ast::IfStatement *if_) {
@@ -357,7 +402,6 @@ std::optional<aast::IfStatement *> Analyser::verify_if(ast::IfStatement *if_) {
     }
 
     std::vector block = std::move(scope.value()->block);
-    delete scope.value();
     auto new_if = new aast::IfStatement(if_->origin, condition.value(), std::move(block));
 
     if (!if_->else_statement || !else_.has_value())
@@ -365,7 +409,6 @@ std::optional<aast::IfStatement *> Analyser::verify_if(ast::IfStatement *if_) {
 
     new_if->else_statement = new aast::ElseStatement(if_->else_statement->origin,
                                                      std::move(else_.value()->block));
-    delete else_.value();
 
     return new_if;
 }
@@ -389,7 +432,7 @@ std::optional<aast::ReturnStatement *> Analyser::verify_return(ast::ReturnStatem
 
     bucket->error(return_->value->origin,
                   "can't return value of type '{}' in function with return type '{}'",
-                  value.value()->type.str(),
+                  value.value()->type->str(),
                   return_type.str())
           ->assert(return_type.is_assignable_from(value.value()->type));
 
@@ -417,7 +460,6 @@ std::optional<aast::WhileStatement *> Analyser::verify_while(ast::WhileStatement
     }
 
     std::vector block = std::move(scope.value()->block);
-    delete scope.value();
     return new aast::WhileStatement(while_->origin, condition.value(), std::move(block));
 }
 
@@ -436,59 +478,45 @@ std::optional<aast::ContinueStatement *> Analyser::verify_continue(ast::Continue
 std::optional<SemanticVariable *> Analyser::verify_variable(ast::VariableStatement *var) {
     std::optional type = verify_type(var->type);
 
-    for (auto *variable : variables) {
+    if (auto *previous = variables.find(var->name.symbol)) {
         bucket->error(var->name.origin, "redefinition of '{}'", var->name.raw)
-              ->note(variable->var->name.origin, "previous definition here")
-              ->assert(var->name.raw != variable->var->name.raw);
+              ->note((*previous)->var->name.origin, "previous definition here")
+              ->assert(false);
     }
 
     if (!type.has_value())
         return {};
 
-    Token name = var->name;
-    name.raw = get_unused_var_name(name.raw);
-    variable_names[var->name.raw] = name.raw;
+    Token name = Token::symbolic(NAME, get_unused_var_name(var->name.symbol), var->name.origin);
 
     auto *new_var = new aast::VariableStatement(var->origin, type.value(), name);
 
-    SemanticVariable *sem;
-    if (type.value().is_primitive()) {
-        sem = new PrimitiveVariable(new_var);
-    } else {
-        if (!is_struct_declared(type.value().get_user()))
-            return {};
-
-        aast::StructStatement *st = get_struct(type.value().get_user());
-
-        std::vector<SemanticVariable *> member_states;
-        for (auto *member : st->members) {
-            auto *temp = new ast::VariableStatement(member->type,
-                                                    Token::name(name.raw + "." + member->name.raw, var->origin));
+    if (!type.value().is_primitive() && !is_struct_declared(type.value().get_user()))
+        return {};
 
-            std::optional semantic_member = verify_variable(temp);
-            if (semantic_member.has_value())
-                member_states.push_back(semantic_member.value());
-        }
+    SemanticVariable *sem = states.add(new_var);
+    // Empty structs are made up of no fields, instead of being tracked as a whole
+    if (!type.value().is_primitive())
+        sem->split = get_struct(type.value().get_user())->members.empty();
 
-        sem = new CompoundVariable(new_var, member_states);
-    }
-    variables.push_back(sem);
+    variables.insert(var->name.symbol, sem);
+    unique_variables.emplace(name.symbol, sem);
     return {sem};
 }
 
 std::optional<aast::StructStatement *> Analyser::verify_struct(ast::StructStatement *struct_) {
     std::vector<std::string> registered;
-    Path struct_path = Path({struct_->name.raw}, struct_->name.origin).with_prefix(path);
+    Path struct_path = Path({std::string(struct_->name.raw)}, struct_->name.origin).with_prefix(path);
 
-    for (const auto &[path, registered] : structures) {
+    if (auto it = declarations->structures.find(struct_path); it != declarations->structures.end()) {
         bucket->error(struct_->name.origin, "redefinition of '{}'", struct_->name.raw)
-              ->note(registered->path.origin, "previous definition here")
-              ->assert(path != struct_path);
+              ->note(it->second->path.origin, "previous definition here")
+              ->assert(false);
     }
 
     std::vector<aast::VariableStatement *> members;
 
-    StructureNode *node = structure_graph.get_node(get_struct_decl(struct_path));
+    StructureNode *node = declarations->structure_graph.get_node(get_struct_decl(struct_path));
 
     for (auto *member : struct_->members) {
         bucket->error(member->name.origin, "duplicate member '{}'", member->name.raw)
@@ -496,10 +524,11 @@ std::optional<aast::StructStatement *> Analyser::verify_struct(ast::StructStatem
 
         std::optional member_type = verify_type(member->type);
 
-        registered.push_back(member->name.raw);
+        registered.emplace_back(member->name.raw);
         if (member_type.has_value()) {
             if (!member_type.value().is_primitive()) {
-                StructureNode *field_node = structure_graph.get_node(get_struct_decl(member_type.value().get_user()));
+                StructureNode *field_node = declarations->structure_graph.get_node(
+                    get_struct_decl(member_type.value().get_user()));
 
                 if (!bucket->error(member->origin,
                                    "'{}' recursively includes '{}'",
@@ -514,7 +543,7 @@ std::optional<aast::StructStatement *> Analyser::verify_struct(ast::StructStatem
     }
 
     auto *new_struct = new aast::StructStatement(struct_->origin, struct_path, members);
-    structures.emplace(struct_path, new_struct);
+    declarations->structures.emplace(struct_path, new_struct);
 
     return new_struct;
 }
@@ -578,12 +607,12 @@ std::optional<aast::Expression *> Analyser::verify_expression(ast::Expression *e
 
         if (expr.has_value()) {
             Error *error = bucket->error(expr.value()->origin, "can't cast between compound types");
-            if (expr.value()->type.pointer_level == 0)
+            if (expr.value()->type->pointer_level == 0)
                 error->note(expr.value()->origin,
                             "you should create an as_{} function in {} to perform this conversion",
                             ce->target_type.func_name(),
-                            expr.value()->type.str());
-            error->assert(expr.value()->type.is_primitive() && ce->target_type.is_primitive());
+                            expr.value()->type->str());
+            error->assert(expr.value()->type->is_primitive() && ce->target_type.is_primitive());
 
             return new aast::CastExpression(expression->origin, ce->target_type, expr.value());
         }
@@ -617,8 +646,9 @@ std::optional<aast::Expression *> Analyser::verify_expression(ast::Expression *e
             return {};
         }
 
-        Token var_name = Token::name("_" + type.value().func_name() + "_init", sie->origin);
-        var_name.raw = get_unused_var_name(var_name.raw);
+        Token var_name = Token::symbolic(NAME,
+                                         get_unused_var_name(Symbol("_" + type.value().func_name() + "_init")),
+                                         sie->origin);
 
         auto *var = new aast::VariableStatement(sie->origin, type.value(), var_name);
         auto *plain_var = new aast::VariableExpression(sie->origin, var);
@@ -634,17 +664,16 @@ std::optional<aast::Expression *> Analyser::verify_expression(ast::Expression *e
             if (member->type.is_float() && field_verified.value()->expression_type == aast::INT_EXPR) {
                 auto *real = new aast::RealExpression(field_verified.value()->origin,
                                                       (double) ((aast::IntExpression *) field_verified.value())->n);
-                delete field_verified.value();
                 field_verified = real;
             }
 
             if (bucket->error(field->origin,
                               "trying to initialise field of type '{}' with value of type '{}'",
                               member->type.str(),
-                              field_verified.value()->type.str())
+                              field_verified.value()->type->str())
                       ->assert(member->type.is_assignable_from(field_verified.value()->type))) {
                 auto *member_name = new
-                        aast::NameExpression(field->origin, member->name.raw);
+                        aast::NameExpression(field->origin, std::string(member->name.raw));
 
                 auto *member_access = new aast::BinaryExpression(field->origin,
                                                                  member->type,
@@ -680,6 +709,7 @@ std::optional<aast::Expression *> Analyser::verify_call_expression(ast::Expressi
     auto *ce = (ast::CallExpression *) expression;
 
     Path func_path = Path({}, LexerRange());
+    aast::FuncStCommon *func = nullptr;
     std::vector<aast::Expression *> arguments;
 
     if (auto *gl = (ast::PrefixExpression *) ce->callee;
@@ -701,57 +731,51 @@ std::optional<aast::Expression *> Analyser::verify_call_expression(ast::Expressi
             return {};
 
         std::string member_name = ((ast::NameExpression *) mem->right)->name;
+        Symbol method_name = Symbol(member_name);
 
-        if (callee_parent.value()->type.is_primitive() && callee_parent.value()->type.get_primitive() == U0) {
+        if (callee_parent.value()->type->is_primitive() && callee_parent.value()->type->get_primitive() == U0) {
+            int pointer_level = callee_parent.value()->type->pointer_level;
             std::vector possible_types = {U8, U16, U32, U64};
-            auto *ie = (ast::IntExpression *) callee_parent.value();
-            if (ie->n < 0)
+            // Only plain literals are known not to be negative
+            if (callee_parent.value()->expression_type != aast::INT_EXPR ||
+                ((aast::IntExpression *) callee_parent.value())->n < 0)
                 possible_types.insert(possible_types.end(), {I8, I16, I32, I64});
 
-            std::vector<TypeSize> types_with_matching_functions;
+            std::vector<std::pair<TypeSize, aast::FuncDeclareStatement *>> types_with_matching_functions;
             for (auto type : possible_types) {
-                Type dummy = Type(type, callee_parent.value()->type.pointer_level);
-                if (is_func_declared(dummy.get_path().create_member(member_name))) {
-                    types_with_matching_functions.push_back(type);
-                }
+                const Methods *methods = find_methods(Type(type, pointer_level), method_name);
+                if (methods && methods->direct)
+                    types_with_matching_functions.emplace_back(type, methods->direct);
             }
 
             Error *error = bucket->error(ce->origin, "ambiguous function call");
-            for (auto type : types_with_matching_functions) {
-                Type dummy = Type(type, callee_parent.value()->type.pointer_level);
-                error->note(get_func_decl(dummy.get_path().create_member(member_name))->origin,
-                            "possible candidate function here");
-            }
+            for (auto [type, decl] : types_with_matching_functions)
+                error->note(decl->origin, "possible candidate function here");
             if (!error->assert(types_with_matching_functions.size() <= 1))
                 return {};
 
-            if (types_with_matching_functions.size() == 1) {
-                callee_parent.value()->type = Type(types_with_matching_functions[0],
-                                                   callee_parent.value()->type.pointer_level);
-            }
+            if (types_with_matching_functions.size() == 1)
+                callee_parent.value()->type = Type(types_with_matching_functions[0].first, pointer_level);
         }
 
-        func_path = callee_parent.value()->type.get_path();
-        func_path = func_path.create_member(member_name);
-
-        if (callee_parent.value()->type.pointer_level > 0) {
-            Type dummy = callee_parent.value()->type.get_deref();
-            Path deref_func = dummy.get_path().create_member(member_name);
-            if (is_func_declared(deref_func)) {
-                aast::FuncDeclareStatement *decl = get_func_decl(deref_func);
-                if (decl->arguments[0]->name.raw == "this" &&
-                    decl->arguments[0]->type == callee_parent.value()->type) {
-                    if (is_func_declared(func_path)) {
-                        bucket->error(ce->origin, "ambigious function call")
-                              ->note(get_func_decl(func_path)->origin, "possible candidate function here")
-                              ->note(decl->origin, "possible candidate function here");
-                        return {};
-                    }
-                    func_path = deref_func;
+        if (const Methods *methods = find_methods(callee_parent.value()->type, method_name)) {
+            func = methods->direct;
+            if (methods->deref) {
+                if (methods->direct) {
+                    bucket->error(ce->origin, "ambigious function call")
+                          ->note(methods->direct->origin, "possible candidate function here")
+                          ->note(methods->deref->origin, "possible candidate function here");
+                    return {};
                 }
+                func = methods->deref;
             }
         }
 
+        if (func)
+            func_path = func->path;
+        else
+            func_path = callee_parent.value()->type->get_path().create_member(member_name);
+
         arguments.push_back(callee_parent.value());
     } else if (ce->callee->expression_type == ast::MACRO_NAME_EXPR) {
         return verify_macro_expression(expression);
@@ -760,10 +784,12 @@ std::optional<aast::Expression *> Analyser::verify_call_expression(ast::Expressi
         return {};
     }
 
+    // Member functions that aren't in the index might still be declared relative to the current path
+    if (!func)
+        func = get_func_decl(func_path);
     if (!bucket->error(ce->callee->origin, "undefined function '{}'", func_path.str())
-               ->assert(is_func_declared(func_path)))
+               ->assert(func))
         return {};
-    aast::FuncStCommon *func = get_func_decl(func_path);
     Path func_parent = func->path.get_parent();
 
     size_t arg_offset = 0;
@@ -771,19 +797,18 @@ std::optional<aast::Expression *> Analyser::verify_call_expression(ast::Expressi
         to_typesize(func_parent.str()) != (TypeSize) -1 ||
         func->path.contains_pointer()) {
         if (!func->arguments.empty() && func->arguments[0]->name.raw == "this") {
-            if (func->arguments[0]->type.pointer_level == arguments[0]->type.pointer_level + 1)
+            if (func->arguments[0]->type.pointer_level == arguments[0]->type->pointer_level + 1)
                 arguments[0] = new aast::PrefixExpression(arguments[0]->origin,
                                                           arguments[0]->type.get_pointer_to(),
                                                           aast::REF,
                                                           arguments[0]);
-            else if (arguments[0]->flattens_to_member_access() && !arguments[0]->type.is_copyable()) {
-                get_variable(arguments[0]->flatten_to_member_access())->state()->make_definitely_moved(
-                    arguments[0]->origin);
+            else if (arguments[0]->flattens_to_member_access() && !arguments[0]->type->is_copyable()) {
+                states.make_definitely_moved(find_variable(arguments[0]), arguments[0]->origin);
             }
 
             bucket->error(arguments[0]->origin,
                           "passing value of type '{}' to argument of type '{}'",
-                          arguments[0]->type.str(),
+                          arguments[0]->type->str(),
                           func->arguments[0]->type.str())
                   ->assert(func->arguments[0]->type.is_assignable_from(arguments[0]->type));
             arg_offset = 1;
@@ -825,13 +850,12 @@ std::optional<aast::Expression *> Analyser::verify_call_expression(ast::Expressi
                 if (arg_var->type.is_float() && argument.value()->expression_type == aast::INT_EXPR) {
                     auto *real = new aast::RealExpression(argument.value()->origin,
                                                           (double) ((aast::IntExpression *) argument.value())->n);
-                    delete argument.value();
                     argument = real;
                 }
 
                 bucket->error(arg->origin,
                               "passing value of type '{}' to argument of type '{}'",
-                              argument.value()->type.str(),
+                              argument.value()->type->str(),
                               arg_var->type.str())
                       ->assert(arg_var->type.is_assignable_from(argument.value()->type));
             }
@@ -853,15 +877,12 @@ std::optional<aast::Expression *> Analyser::verify_macro_expression(ast::Express
         auto *mem = (ast::BinaryExpression *) ce->callee;
         ce->arguments.insert(ce->arguments.begin(), mem->left);
 
-        ast::Expression *callee = mem->right;
-        mem->right = nullptr;
-        mem->left = nullptr;
-        delete mem;
-
-        ce->callee = callee;
+        ce->callee = mem->right;
     }
 
-    Macro *macro = macros[((ast::MacroNameExpression *) ce->callee)->name];
+    // Function bodies are verified concurrently, so this must not insert into the table
+    auto macro_it = declarations->macros.find(((ast::MacroNameExpression *) ce->callee)->name);
+    Macro *macro = macro_it != declarations->macros.end() ? macro_it->second : nullptr;
 
     if (!bucket->error(expression->origin, "undefined macro {}", ce->callee->print())->assert(!!macro))
         return {};
@@ -929,38 +950,36 @@ std::optional<aast::BinaryExpression *> Analyser::verify_binary_expression(
     if (!left.has_value() || !right.has_value())
         return {};
 
-    if (left.value()->type.is_float() && right.value()->expression_type == aast::INT_EXPR) {
+    if (left.value()->type->is_float() && right.value()->expression_type == aast::INT_EXPR) {
         auto *real = new aast::RealExpression(right.value()->origin,
                                               (double) ((aast::IntExpression *) right.value())->n);
-        delete right.value();
         right = real;
     }
 
-    if (right.value()->type.is_float() && left.value()->expression_type == aast::INT_EXPR) {
+    if (right.value()->type->is_float() && left.value()->expression_type == aast::INT_EXPR) {
         auto *real = new aast::RealExpression(left.value()->origin,
                                               (double) ((aast::IntExpression *) left.value())->n);
-        delete left.value();
         left = real;
     }
 
     if (ae->expression_type == ast::ASSIGN_EXPR) {
         bucket->error(ae->right->origin,
                       "can't assign to type '{}' from '{}'",
-                      left.value()->type.str(),
-                      right.value()->type.str())
-              ->assert(left.value()->type.is_assignable_from(right.value()->type));
+                      left.value()->type->str(),
+                      right.value()->type->str())
+              ->assert(left.value()->type->is_assignable_from(right.value()->type));
     } else if (ae->expression_type == ast::EQ_EXPR || ae->expression_type == ast::COMP_EXPR) {
         bucket->error(ae->origin,
                       "invalid operands to binary expression '{}' and '{}'",
-                      left.value()->type.str(),
-                      right.value()->type.str())
-              ->assert(left.value()->type.is_comparable(right.value()->type));
+                      left.value()->type->str(),
+                      right.value()->type->str())
+              ->assert(left.value()->type->is_comparable(right.value()->type));
     } else /*if (math expression)*/ {
         bucket->error(ae->origin,
                       "invalid operands to binary expression '{}' and '{}'",
-                      left.value()->type.str(),
-                      right.value()->type.str())
-              ->assert(left.value()->type.is_compatible(right.value()->type));
+                      left.value()->type->str(),
+                      right.value()->type->str())
+              ->assert(left.value()->type->is_compatible(right.value()->type));
     }
 
     Type expression_type;
@@ -969,7 +988,7 @@ std::optional<aast::BinaryExpression *> Analyser::verify_binary_expression(
     else if (expression->expression_type == ast::ASSIGN_EXPR)
         expression_type = left.value()->type;
     else
-        expression_type = left.value()->type.get_result(right.value()->type);
+        expression_type = left.value()->type->get_result(right.value()->type);
 
     aast::BinOpType bot;
 
@@ -1033,13 +1052,13 @@ std::optional<aast::BinaryExpression *> Analyser::verify_member_access_expressio
                ->assert(mae->right->expression_type == ast::NAME_EXPR))
         return {};
 
-    if (!bucket->error(left.value()->origin, "'{}' is not a structure", left.value()->type.str())
-               ->assert(!left.value()->type.is_primitive()))
+    if (!bucket->error(left.value()->origin, "'{}' is not a structure", left.value()->type->str())
+               ->assert(!left.value()->type->is_primitive()))
         return {};
 
-    Path struct_name = left.value()->type.get_user();
+    Path struct_name = left.value()->type->get_user();
 
-    if (!bucket->error(left.value()->origin, "undefined structure '{}'", left.value()->type.str())
+    if (!bucket->error(left.value()->origin, "undefined structure '{}'", left.value()->type->str())
                ->assert(is_struct_declared(struct_name)))
         return {};
 
@@ -1049,19 +1068,14 @@ std::optional<aast::BinaryExpression *> Analyser::verify_member_access_expressio
     if (!bucket->error(mae->right->origin,
                        "no member named '{}' in '{}'",
                        member_name,
-                       left.value()->type.str())
+                       left.value()->type->str())
                ->assert(st->has_member(member_name)))
         return {};
 
     Type member_type = st->get_member_type(member_name);
 
-    if (left.value()->flattens_to_member_access()) {
-        auto *name = new ast::NameExpression(mae->origin,
-                                             left.value()->flatten_to_member_access() + "." + member_name);
-
-        verify_name_expression(name, access);
-        delete name;
-    }
+    if (left.value()->flattens_to_member_access())
+        verify_access(states.get_field(find_variable(left.value()), st, member_name), mae->origin, access);
 
     return new aast::BinaryExpression(mae->origin,
                                       member_type,
@@ -1079,26 +1093,26 @@ std::optional<aast::PrefixExpression *> Analyser::verify_prefix_expression(
     if (!operand.has_value())
         return {};
 
-    Type pe_type = operand.value()->type;
+    TypeId pe_type = operand.value()->type;
 
     switch (pe->prefix_type) {
     case ast::NEG:
         bucket->error(pe->operand->origin, "invalid operand to prefix expression")
-              ->assert(pe_type.pointer_level == 0);
+              ->assert(pe_type->pointer_level == 0);
     case ast::LOG_NOT:
         bucket->error(pe->operand->origin, "invalid operand to prefix expression")
-              ->assert(pe_type.is_primitive() || pe_type.pointer_level > 0);
+              ->assert(pe_type->is_primitive() || pe_type->pointer_level > 0);
         break;
     case ast::REF: {
-        pe_type.pointer_level++;
+        pe_type = pe_type.get_pointer_to();
         break;
     }
     case ast::DEREF:
-        bucket->error(pe->operand->origin, "cannot dereference non-pointer type '{}'", operand.value()->type.str())
-              ->assert(pe_type.pointer_level > 0);
-        bucket->error(pe->operand->origin, "cannot copy non-primitive type '{}'", operand.value()->type.str())
-              ->assert(pe_type.is_primitive() || pe_type.pointer_level > 1);
-        pe_type.pointer_level--;
+        bucket->error(pe->operand->origin, "cannot dereference non-pointer type '{}'", operand.value()->type->str())
+              ->assert(pe_type->pointer_level > 0);
+        bucket->error(pe->operand->origin, "cannot copy non-primitive type '{}'", operand.value()->type->str())
+              ->assert(pe_type->is_primitive() || pe_type->pointer_level > 1);
+        pe_type = pe_type.get_deref();
         break;
     case ast::GLOBAL:
         bucket->error(pe->origin, "unexpected global path prefix")
@@ -1133,10 +1147,10 @@ std::optional<aast::Expression *> Analyser::verify_name_expression(ast::Expressi
                                                                    bool member_acc) {
     auto *ne = (ast::NameExpression *) expression;
     if (!bucket->error(expression->origin, "undefined variable '{}'", ne->name)
-               ->assert(is_var_declared(ne->name)))
+               ->assert(is_var_declared(Symbol(ne->name))))
         return {};
 
-    SemanticVariable *var = get_variable(ne->name);
+    SemanticVariable *var = get_variable(Symbol(ne->name));
 
     Type variable_type = var->var->type;
 
@@ -1151,33 +1165,37 @@ std::optional<aast::Expression *> Analyser::verify_name_expression(ast::Expressi
     if (member_acc)
         return new_expr;
 
+    verify_access(var, expression->origin, access);
+
+    return new_expr;
+}
+
+void Analyser::verify_access(SemanticVariable *var, LexerRange origin, AccessType access) {
     if (access == ASSIGNMENT) {
-        if (var->state()->is_definitely_defined()) {
-            bucket->warning(var->state()->get_defined_pos(), "assigned value is immediately discarded")
-                  ->note(expression->origin, "overwritten here");
-        } else if (var->state()->is_maybe_defined()) {
-            bucket->warning(expression->origin, "value might overwrite previous assignment without reading it");
+        if (states.is_definitely_defined(var)) {
+            bucket->warning(states.get_defined_pos(var), "assigned value is immediately discarded")
+                  ->note(origin, "overwritten here");
+        } else if (states.is_maybe_defined(var)) {
+            bucket->warning(origin, "value might overwrite previous assignment without reading it");
         }
 
-        var->state()->make_definitely_defined(expression->origin);
-    } else if (bucket->error(expression->origin, "value is still undefined")
-                     ->assert(!var->state()->is_definitely_undefined()) &&
-               bucket->error(expression->origin, "value might be undefined")
-                     ->assert(!var->state()->is_maybe_undefined()) &&
-               bucket->error(expression->origin, "value was moved")
-                     ->note(var->state()->get_moved_pos(), "moved here")
-                     ->assert(!var->state()->is_definitely_moved()) &&
-               bucket->error(expression->origin, "value might have been moved")
-                     ->note(var->state()->get_moved_pos(), "moved here")
-                     ->assert(!var->state()->is_maybe_moved())) {
+        states.make_definitely_defined(var, origin);
+    } else if (bucket->error(origin, "value is still undefined")
+                     ->assert(!states.is_definitely_undefined(var)) &&
+               bucket->error(origin, "value might be undefined")
+                     ->assert(!states.is_maybe_undefined(var)) &&
+               bucket->error(origin, "value was moved")
+                     ->note(states.get_moved_pos(var), "moved here")
+                     ->assert(!states.is_definitely_moved(var)) &&
+               bucket->error(origin, "value might have been moved")
+                     ->note(states.get_moved_pos(var), "moved here")
+                     ->assert(!states.is_maybe_moved(var))) {
         if (access == NORMAL) {
-            var->state()->make_definitely_read();
+            states.make_definitely_read(var);
         } else if (access == MOVE && !var->var->type.is_copyable()) {
-            var->state()->make_definitely_moved(expression->origin);
+            states.make_definitely_moved(var, origin);
         }
     }
-
-    return new_expr;
 }
 
 std::optional<Type> Analyser::verify_type(Type type) {
@@ -1205,14 +1223,15 @@ std::optional<Type> Analyser::verify_type(Type type) {
     return type;
 }
 
-std::string Analyser::get_unused_var_name(const std::string &candidate) {
-    std::string name = candidate;
+Symbol Analyser::get_unused_var_name(Symbol candidate) {
+    Symbol name = candidate;
     // If the name was used before, i.e. in a previous, separate scope
     if (used_names.contains(name)) {
         // Find a replacement that wasn't
         for (std::size_t i = 1; i < std::numeric_limits<std::size_t>::max(); i++) {
-            if (!used_names.contains(name + std::to_string(i))) {
-                name += std::to_string(i);
+            Symbol replacement = Symbol(std::string(candidate.str()) + std::to_string(i));
+            if (!used_names.contains(replacement)) {
+                name = replacement;
                 break;
             }
         }
@@ -1235,25 +1254,17 @@ bool Analyser::does_always_return(ast::ScopeStatement *scope) {
     return false;
 }
 
-bool Analyser::is_var_declared(std::string name) const {
-    if (variable_names.contains(name))
-        name = variable_names.at(name);
-    return std::find_if(variables.begin(),
-                        variables.end(),
-                        [name](SemanticVariable *v) {
-                            return name == v->var->name.raw;
-                        }) != variables.end();
+bool Analyser::is_var_declared(Symbol name) const {
+    return variables.contains(name);
 }
 
 bool Analyser::is_func_declared(const Path &path) const {
-    if (path.is_global()) {
-        return func_decls.contains(path);
-    }
-
-    return func_decls.contains(path) || func_decls.contains(path.with_prefix(this->path));
+    return get_func_decl(path);
 }
 
 bool Analyser::is_struct_declared(const Path &path) const {
+    const auto &struct_decls = declarations->struct_decls;
+
     if (path.is_global()) {
         return struct_decls.contains(path);
     }
@@ -1261,30 +1272,91 @@ bool Analyser::is_struct_declared(const Path &path) const {
     return struct_decls.contains(path) || struct_decls.contains(path.with_prefix(this->path));
 }
 
-SemanticVariable *Analyser::get_variable(std::string name) const {
-    if (variable_names.contains(name))
-        name = variable_names.at(name);
-    return *std::find_if(variables.begin(),
-                         variables.end(),
-                         [name](SemanticVariable *v) {
-                             return name == v->var->name.raw;
-                         });
+SemanticVariable *Analyser::find_variable(aast::Expression *expression) {
+    if (expression->expression_type == aast::VAR_EXPR)
+        return unique_variables.at(((aast::VariableExpression *) expression)->var->name.symbol);
+
+    auto *mae = (aast::BinaryExpression *) expression;
+    return states.get_field(find_variable(mae->left),
+                            get_struct(mae->left->type->get_user()),
+                            ((aast::NameExpression *) mae->right)->name);
+}
+
+SemanticVariable *Analyser::get_variable(Symbol name) const {
+    return *variables.find(name);
+}
+
+void Analyser::add_func_decl(const Path &path, aast::FuncDeclareStatement *decl) {
+    // Inside a function body, other bodies might be verified at the same time
+    if (level > 0)
+        local_func_decls.emplace(path, decl);
+    else
+        declarations->add_func_decl(path, decl);
+}
+
+aast::FuncDeclareStatement *Analyser::find_func_decl(const Path &path) const {
+    if (auto it = local_func_decls.find(path); it != local_func_decls.end())
+        return it->second;
+    auto it = declarations->func_decls.find(path);
+    return it != declarations->func_decls.end() ? it->second : nullptr;
 }
 
 aast::FuncDeclareStatement *Analyser::get_func_decl(const Path &path) const {
     if (path.is_global()) {
-        return func_decls.contains(path) ? func_decls.at(path) : nullptr;
+        return find_func_decl(path);
     }
 
-    Path local = path.with_prefix(this->path);
+    if (aast::FuncDeclareStatement *local = find_func_decl(path.with_prefix(this->path)))
+        return local;
 
-    if (func_decls.contains(local))
-        return func_decls.contains(local) ? func_decls.at(local) : nullptr;
+    return find_func_decl(path);
+}
 
-    return func_decls.contains(path) ? func_decls.at(path) : nullptr;
+const Analyser::Methods *Analyser::find_methods(TypeId type, Symbol name) const {
+    // Inside a body, path also names the function and its scopes, so look in every enclosing module up to the root
+    for (Path module = path;; module = module.get_parent()) {
+        if (auto it = declarations->methods.find({type, name, module}); it != declarations->methods.end())
+            return &it->second;
+        if (module.size() == 0)
+            return nullptr;
+    }
+}
+
+void Analyser::Declarations::add_func_decl(const Path &path, aast::FuncDeclareStatement *decl) {
+    if (!func_decls.emplace(path, decl).second)
+        return;
+
+    // Member functions are named after the type they're declared on, read that type back from the path
+    Path type_path = path.get_parent();
+    int pointer_level = 0;
+    while (type_path.size() > 0 && type_path.name() == "*") {
+        type_path = type_path.get_parent();
+        pointer_level++;
+    }
+    if (type_path.size() == 0)
+        return;
+
+    // Struct types carry their module in their path already. Primitives are the last part of the path, anything before
+    // it is the module the method was declared in.
+    Type type = Type(type_path, pointer_level);
+    Path module = Path({}, LexerRange());
+    if (TypeSize primitive = to_typesize(type_path.name()); primitive != (TypeSize) -1) {
+        type = Type(primitive, pointer_level);
+        module = type_path.get_parent();
+    }
+
+    Symbol name = Symbol(path.name());
+    methods[{type, name, module}].direct = decl;
+
+    // Also callable on pointers to the type, if it takes this as one
+    if (!decl->arguments.empty() && decl->arguments[0]->name.raw == "this" &&
+        decl->arguments[0]->type.pointer_level == pointer_level + 1)
+        methods[{type.get_pointer_to(), name, module}].deref = decl;
 }
 
 aast::StructStatement *Analyser::get_struct(const Path &path) const {
+    const auto &structures = declarations->structures;
+
     if (path.is_global()) {
         return structures.contains(path) ? structures.at(path) : nullptr;
     }
@@ -1298,6 +1370,8 @@ aast::StructStatement *Analyser::get_struct(const Path &path) const {
 }
 
 aast::StructDeclareStatement *Analyser::get_struct_decl(const Path &path) const {
+    const auto &struct_decls = declarations->struct_decls;
+
     if (path.is_global()) {
         return struct_decls.contains(path) ? struct_decls.at(path) : nullptr;
     }
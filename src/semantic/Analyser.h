@@ -7,11 +7,13 @@
 #ifndef TARIK_SRC_SEMANTIC_ANALYSER_H_
 #define TARIK_SRC_SEMANTIC_ANALYSER_H_
 
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "Macro.h"
+#include "ScopedTable.h"
 #include "Structures.h"
 #include "error/Bucket.h"
 #include "semantic/ast/Statements.h"
@@ -28,27 +30,77 @@ class Analyser {
     template <bool VARIABLE_ARGS>
     friend class ExternMacro;
 
-    std::vector<aast::FuncStatement *> functions;
-    std::unordered_map<Path, aast::StructStatement *> structures;
+    struct MethodKey {
+        TypeId type;
+        Symbol name;
+        // Methods on primitives are local to the module they are declared in, the root for everything else
+        Path module;
+
+        bool operator==(const MethodKey &other) const = default;
+    };
+
+    struct MethodKeyHash {
+        std::size_t operator()(const MethodKey &key) const noexcept {
+            return (std::hash<TypeId>()(key.type) ^ std::hash<Symbol>()(key.name) * 0x9e3779b97f4a7c15ull) +
+                   key.module.hash() * 31;
+        }
+    };
+
+    struct Methods {
+        // Declared on the type itself, and declared on the type it points to, taking this as a pointer
+        aast::FuncDeclareStatement *direct = nullptr, *deref = nullptr;
+    };
+
+    // Everything declared at file level. Function bodies are verified concurrently once it's complete, and only read
+    // it from then on.
+    struct Declarations {
+        std::unordered_map<Path, aast::StructStatement *> structures;
+
+        std::unordered_map<Path, aast::StructDeclareStatement *> struct_decls;
+        std::unordered_map<Path, aast::FuncDeclareStatement *> func_decls;
+        // Member functions, by the type they're called on and their name, so a call resolves with one lookup
+        std::unordered_map<MethodKey, Methods, MethodKeyHash> methods;
 
-    std::unordered_map<Path, aast::StructDeclareStatement *> struct_decls;
-    std::unordered_map<Path, aast::FuncDeclareStatement *> func_decls;
+        std::unordered_map<std::string, Macro *> macros;
+        std::unordered_map<std::string, std::vector<aast::Statement *>> libraries;
 
-    std::unordered_map<std::string, Macro *> macros;
-    std::unordered_map<std::string, std::vector<aast::Statement *>> libraries;
+        StructureGraph structure_graph;
+
+        void add_func_decl(const Path &path, aast::FuncDeclareStatement *decl);
+    };
+
+    struct PendingFunction {
+        ast::FuncStatement *func;
+        // Path of the module the function is in, and of the function itself
+        Path module_path, path;
+    };
+
+    std::shared_ptr<Declarations> declarations;
+
+    std::vector<aast::FuncStatement *> functions;
+    std::unordered_map<Path, ast::FuncStatement *> defined_functions;
+    std::vector<PendingFunction> pending_functions;
+    // Functions declared inside the body that is being verified. The shared declarations can't change while other
+    // bodies are being verified, so they're only added once all of them are done. Until then, other bodies can't see
+    // them, regardless of their order in the file.
+    std::unordered_map<Path, aast::FuncDeclareStatement *> local_func_decls;
 
     Path path = Path({}, LexerRange());
 
-    std::vector<SemanticVariable *> variables;
-    std::unordered_map<std::string, std::string> variable_names;
-    std::unordered_set<std::string> used_names;
+    // Variables of the current function that are in scope, by the name they were declared with
+    ScopedTable<Symbol, SemanticVariable *> variables;
+    // All variables of the current function, by the unique name they were given
+    std::unordered_map<Symbol, SemanticVariable *> unique_variables;
+    VariableStates states;
+    std::unordered_set<Symbol> used_names;
 
     ast::Statement *last_loop = nullptr;
     unsigned int level = 0;
     Type return_type = Type(VOID);
 
     Bucket *bucket;
-    StructureGraph structure_graph;
+
+    Analyser(std::shared_ptr<Declarations> declarations, Bucket *bucket);
 
 public:
     Analyser(Bucket *bucket, std::unordered_map<std::string, std::vector<aast::Statement *>> libraries);
@@ -70,7 +122,9 @@ protected:
     std::optional<aast::Statement *> verify_statement(ast::Statement *statement);
     std::optional<std::vector<aast::Statement *>> verify_statements(const std::vector<ast::Statement *> &statements);
     std::optional<aast::ScopeStatement *> verify_scope(ast::ScopeStatement *scope, const std::string &name = "");
-    std::optional<aast::FuncStatement *> verify_function(ast::FuncStatement *func);
+    void queue_function(ast::FuncStatement *func);
+    void verify_functions();
+    std::optional<aast::FuncStatement *> verify_function(ast::FuncStatement *func, const Path &func_path);
     std::optional<aast::IfStatement *> verify_if(ast::IfStatement *if_);
     std::optional<aast::ElseStatement *> verify_else(ast::ElseStatement *else_);
     std::optional<aast::ReturnStatement *> verify_return(ast::ReturnStatement *return_);
@@ -96,17 +150,24 @@ protected:
     std::optional<aast::Expression *> verify_name_expression(ast::Expression *expression,
                                                              AccessType access = NORMAL,
                                                              bool member_acc = false);
+    // Check and update the state of var, for an access of the given type at origin
+    void verify_access(SemanticVariable *var, LexerRange origin, AccessType access);
 
     std::optional<Type> verify_type(Type type);
-    std::string get_unused_var_name(const std::string &candidate);
+    Symbol get_unused_var_name(Symbol candidate);
 
     bool does_always_return(ast::ScopeStatement *scope);
-    bool is_var_declared(std::string name) const;
+    bool is_var_declared(Symbol name) const;
     bool is_func_declared(const Path &path) const;
     bool is_struct_declared(const Path &path) const;
 
-    SemanticVariable *get_variable(std::string name) const;
+    SemanticVariable *get_variable(Symbol name) const;
+    // The variable or field an expression that flattens to a member access refers to
+    SemanticVariable *find_variable(aast::Expression *expression);
+    void add_func_decl(const Path &path, aast::FuncDeclareStatement *decl);
+    aast::FuncDeclareStatement *find_func_decl(const Path &path) const;
     aast::FuncDeclareStatement *get_func_decl(const Path &path) const;
+    const Methods *find_methods(TypeId type, Symbol name) const;
     aast::StructStatement *get_struct(const Path &path) const;
     aast::StructDeclareStatement *get_struct_decl(const Path &path) const;
 };
@@ -0,0 +1,386 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "Folding.h"
+
+#include <cmath>
+#include <compare>
+#include <climits>
+#include <optional>
+
+namespace
+{
+// The value of a literal. Integers are kept extended from the width of their type according to its signedness, untyped
+// literals are exact.
+struct Constant {
+    TypeId type;
+    long long integer = 0;
+    double real = 0;
+    bool boolean = false;
+};
+
+bool is_untyped(const Type &type) {
+    return type == Type(U0);
+}
+
+bool is_integer(const Type &type) {
+    return type.pointer_level == 0 && (type.is_signed_int() || type.is_unsigned_int());
+}
+
+// Codegen emits untyped literals as unsigned integers, unless they are negative
+bool is_unsigned(const Constant &constant) {
+    if (is_untyped(constant.type))
+        return constant.integer >= 0;
+    return constant.type->is_unsigned_int();
+}
+
+unsigned long long mask(const Type &type) {
+    std::size_t width = type.get_integer_bitwidth();
+    return width >= 64 ? ~0ull : (1ull << width) - 1;
+}
+
+// Truncate value to the width of type, and extend it back according to the type's signedness
+long long wrap(const Type &type, unsigned long long value) {
+    if (is_untyped(type))
+        return (long long) value;
+
+    unsigned long long m = mask(type);
+    value &= m;
+    if (type.is_signed_int() && value > m >> 1)
+        value |= ~m;
+    return (long long) value;
+}
+
+double round_to(const Type &type, double value) {
+    return type.get_primitive() == F32 ? (double) (float) value : value;
+}
+
+std::optional<Constant> get_constant(aast::Expression *expression) {
+    switch (expression->expression_type) {
+    case aast::INT_EXPR:
+        return Constant {.type = expression->type, .integer = ((aast::IntExpression *) expression)->n};
+    case aast::REAL_EXPR:
+        return Constant {.type = expression->type, .real = ((aast::RealExpression *) expression)->n};
+    case aast::BOOL_EXPR:
+        return Constant {.type = expression->type, .boolean = ((aast::BoolExpression *) expression)->n};
+    default:
+        return {};
+    }
+}
+
+aast::Expression *make_integer(const LexerRange &origin, TypeId type, long long value) {
+    auto *literal = new aast::IntExpression(origin, value);
+    literal->type = type;
+    return literal;
+}
+
+aast::Expression *make_real(const LexerRange &origin, TypeId type, double value) {
+    auto *literal = new aast::RealExpression(origin, value);
+    literal->type = type;
+    return literal;
+}
+
+std::optional<bool> compare(aast::BinOpType op, std::partial_ordering order) {
+    // Unordered floats compare false, except for inequality, the same as the ordered predicates codegen uses
+    switch (op) {
+    case aast::EQ:
+        return order == 0;
+    case aast::NEQ:
+        return order < 0 || order > 0;
+    case aast::SM:
+        return order < 0;
+    case aast::GR:
+        return order > 0;
+    case aast::SME:
+        return order <= 0;
+    case aast::GRE:
+        return order >= 0;
+    default:
+        return {};
+    }
+}
+
+std::optional<bool> fold_comparison(aast::BinOpType op, const Constant &left, const Constant &right) {
+    if (left.type->is_bool() || right.type->is_bool()) {
+        if (!left.type->is_bool() || !right.type->is_bool() || (op != aast::EQ && op != aast::NEQ))
+            return {};
+        return compare(op, left.boolean <=> right.boolean);
+    }
+
+    if (left.type->is_float() || right.type->is_float()) {
+        if (!left.type->is_float() || !right.type->is_float())
+            return {};
+        Type common = left.type->get_result(right.type);
+        return compare(op, round_to(common, left.real) <=> round_to(common, right.real));
+    }
+
+    if (!is_integer(left.type) || !is_integer(right.type))
+        return {};
+
+    if (is_untyped(left.type) && is_untyped(right.type))
+        return compare(op, left.integer <=> right.integer);
+
+    Type common = left.type->get_result(right.type);
+    long long a = wrap(common, left.integer), b = wrap(common, right.integer);
+    if (is_unsigned(left) || is_unsigned(right))
+        return compare(op, (a & mask(common)) <=> (b & mask(common)));
+    return compare(op, a <=> b);
+}
+
+std::optional<double> fold_real(aast::BinOpType op, const Type &type, const Constant &left, const Constant &right) {
+    if (!left.type->is_float() || !right.type->is_float())
+        return {};
+
+    // Operands are converted to the result type first, so f32 arithmetic rounds like it would at runtime
+    double a = round_to(type, left.real), b = round_to(type, right.real);
+    switch (op) {
+    case aast::ADD:
+        return round_to(type, a + b);
+    case aast::SUB:
+        return round_to(type, a - b);
+    case aast::MUL:
+        return round_to(type, a * b);
+    case aast::DIV:
+        return round_to(type, a / b);
+    default:
+        return {};
+    }
+}
+
+std::optional<long long> fold_integer(aast::BinOpType op,
+                                      const Type &type,
+                                      const Constant &left,
+                                      const Constant &right) {
+    if (!is_integer(left.type) || !is_integer(right.type))
+        return {};
+
+    if (is_untyped(type)) {
+        // Exact, so anything that doesn't fit into an i64 is left for codegen
+        long long result;
+        switch (op) {
+        case aast::ADD:
+            return __builtin_add_overflow(left.integer, right.integer, &result) ? std::nullopt : std::optional(result);
+        case aast::SUB:
+            return __builtin_sub_overflow(left.integer, right.integer, &result) ? std::nullopt : std::optional(result);
+        case aast::MUL:
+            return __builtin_mul_overflow(left.integer, right.integer, &result) ? std::nullopt : std::optional(result);
+        case aast::DIV:
+            if (right.integer == 0 || (left.integer == LLONG_MIN && right.integer == -1))
+                return {};
+            return left.integer / right.integer;
+        default:
+            return {};
+        }
+    }
+
+    auto a = (unsigned long long) wrap(type, left.integer), b = (unsigned long long) wrap(type, right.integer);
+    switch (op) {
+    case aast::ADD:
+        return wrap(type, a + b);
+    case aast::SUB:
+        return wrap(type, a - b);
+    case aast::MUL:
+        return wrap(type, a * b);
+    case aast::DIV: {
+        unsigned long long m = mask(type);
+        if ((b & m) == 0)
+            return {};
+        if (is_unsigned(left) || is_unsigned(right))
+            return wrap(type, (a & m) / (b & m));
+        // Division of the smallest value by -1 overflows, which is undefined at runtime as well
+        if ((long long) a == wrap(type, (m >> 1) + 1) && (long long) b == -1)
+            return {};
+        return wrap(type, (unsigned long long) ((long long) a / (long long) b));
+    }
+    default:
+        return {};
+    }
+}
+
+aast::Expression *fold_binary(aast::BinaryExpression *expression) {
+    std::optional left = get_constant(expression->left), right = get_constant(expression->right);
+    if (!left.has_value() || !right.has_value())
+        return expression;
+
+    const Type &type = expression->type;
+    if (type.is_bool()) {
+        if (std::optional result = fold_comparison(expression->bin_op_type, left.value(), right.value()))
+            return new aast::BoolExpression(expression->origin, result.value());
+    } else if (type.is_float()) {
+        if (std::optional result = fold_real(expression->bin_op_type, type, left.value(), right.value()))
+            return make_real(expression->origin, expression->type, result.value());
+    } else if (is_integer(type)) {
+        if (std::optional result = fold_integer(expression->bin_op_type, type, left.value(), right.value()))
+            return make_integer(expression->origin, expression->type, result.value());
+    }
+
+    return expression;
+}
+
+aast::Expression *fold_prefix(aast::PrefixExpression *expression) {
+    std::optional operand = get_constant(expression->operand);
+    if (!operand.has_value())
+        return expression;
+
+    const Type &type = expression->type;
+    if (expression->prefix_type == aast::NEG) {
+        if (type.is_float())
+            return make_real(expression->origin, expression->type, -operand->real);
+        if (is_untyped(type) && operand->integer != LLONG_MIN)
+            return make_integer(expression->origin, expression->type, -operand->integer);
+        if (is_integer(type) && !is_untyped(type))
+            return make_integer(expression->origin,
+                                expression->type,
+                                wrap(type, 0ull - (unsigned long long) operand->integer));
+    } else if (expression->prefix_type == aast::LOG_NOT && type.is_bool()) {
+        return new aast::BoolExpression(expression->origin, !operand->boolean);
+    }
+
+    return expression;
+}
+
+aast::Expression *fold_cast(aast::CastExpression *expression) {
+    std::optional value = get_constant(expression->expression);
+    // Casts from and to bools truncate and extend single bits, so they're left for codegen
+    if (!value.has_value() || value->type->is_bool())
+        return expression;
+
+    const Type &target = expression->type;
+    if (target.pointer_level == 0 && target.is_float()) {
+        double real;
+        if (value->type->is_float())
+            real = value->real;
+        else if (is_untyped(value->type) || value->type->is_signed_int())
+            real = (double) value->integer;
+        else
+            real = (double) (unsigned long long) value->integer;
+
+        return make_real(expression->origin, expression->type, round_to(target, real));
+    }
+
+    if (!is_integer(target) || is_untyped(target))
+        return expression;
+
+    if (!value->type->is_float())
+        return make_integer(expression->origin, expression->type, wrap(target, value->integer));
+
+    // Floats that don't fit into the target produce poison at runtime, so those aren't folded
+    double truncated = std::trunc(value->real);
+    int width = (int) target.get_integer_bitwidth();
+    if (target.is_signed_int()) {
+        if (!(truncated >= -std::ldexp(1.0, width - 1) && truncated < std::ldexp(1.0, width - 1)))
+            return expression;
+        return make_integer(expression->origin, expression->type, (long long) truncated);
+    }
+    if (!(truncated >= 0 && truncated < std::ldexp(1.0, width)))
+        return expression;
+    return make_integer(expression->origin, expression->type, wrap(target, (unsigned long long) truncated));
+}
+
+void fold_statement(aast::Statement *statement, std::vector<aast::Statement *> &folded) {
+    switch (statement->statement_type) {
+    case aast::SCOPE_STMT:
+    case aast::FUNC_STMT:
+    case aast::IMPORT_STMT:
+        fold_statements(((aast::ScopeStatement *) statement)->block);
+        break;
+    case aast::IF_STMT: {
+        auto *if_ = (aast::IfStatement *) statement;
+        if_->condition = fold_expression(if_->condition);
+        fold_statements(if_->block);
+        if (if_->else_statement)
+            fold_statements(if_->else_statement->block);
+
+        if (if_->condition->expression_type != aast::BOOL_EXPR)
+            break;
+
+        // Variable names are unique per function, so the taken branch can be spliced into the surrounding block
+        if (((aast::BoolExpression *) if_->condition)->n)
+            folded.insert(folded.end(), if_->block.begin(), if_->block.end());
+        else if (if_->else_statement)
+            folded.insert(folded.end(), if_->else_statement->block.begin(), if_->else_statement->block.end());
+        return;
+    }
+    case aast::WHILE_STMT: {
+        auto *while_ = (aast::WhileStatement *) statement;
+        while_->condition = fold_expression(while_->condition);
+        fold_statements(while_->block);
+
+        if (while_->condition->expression_type == aast::BOOL_EXPR && !((aast::BoolExpression *) while_->condition)->n)
+            return;
+        break;
+    }
+    case aast::RETURN_STMT: {
+        auto *return_ = (aast::ReturnStatement *) statement;
+        if (return_->value)
+            return_->value = fold_expression(return_->value);
+        break;
+    }
+    case aast::EXPR_STMT:
+        statement = fold_expression((aast::Expression *) statement);
+        break;
+    default:
+        break;
+    }
+
+    folded.push_back(statement);
+}
+} // namespace
+
+void fold_statements(std::vector<aast::Statement *> &statements) {
+    std::vector<aast::Statement *> folded;
+    folded.reserve(statements.size());
+    for (auto *statement : statements)
+        fold_statement(statement, folded);
+    statements = std::move(folded);
+}
+
+aast::Expression *fold_expression(aast::Expression *expression) {
+    switch (expression->expression_type) {
+    case aast::CALL_EXPR:
+        for (auto *&argument : ((aast::CallExpression *) expression)->arguments)
+            argument = fold_expression(argument);
+        break;
+    case aast::DASH_EXPR:
+    case aast::DOT_EXPR:
+    case aast::EQ_EXPR:
+    case aast::COMP_EXPR: {
+        auto *be = (aast::BinaryExpression *) expression;
+        be->left = fold_expression(be->left);
+        be->right = fold_expression(be->right);
+        return fold_binary(be);
+    }
+    case aast::ASSIGN_EXPR: {
+        auto *ae = (aast::BinaryExpression *) expression;
+        ae->left = fold_expression(ae->left);
+        ae->right = fold_expression(ae->right);
+        break;
+    }
+    case aast::MEM_ACC_EXPR: {
+        auto *mae = (aast::BinaryExpression *) expression;
+        mae->left = fold_expression(mae->left);
+        break;
+    }
+    case aast::PREFIX_EXPR: {
+        auto *pe = (aast::PrefixExpression *) expression;
+        pe->operand = fold_expression(pe->operand);
+        return fold_prefix(pe);
+    }
+    case aast::CAST_EXPR: {
+        auto *ce = (aast::CastExpression *) expression;
+        ce->expression = fold_expression(ce->expression);
+        return fold_cast(ce);
+    }
+    case aast::VAR_EXPR:
+        // Struct initialisers are lowered to assignments to a temporary
+        fold_statements(((aast::VariableExpression *) expression)->prelude);
+        break;
+    default:
+        break;
+    }
+
+    return expression;
+}
@@ -0,0 +1,23 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_SEMANTIC_FOLDING_H
+#define TARIK_SRC_SEMANTIC_FOLDING_H
+
+#include <vector>
+
+#include "ast/Expression.h"
+#include "ast/Statements.h"
+
+// Evaluate arithmetic, comparisons and casts on literals at compile time, and drop the branches of ifs and whiles
+// whose condition folds to a constant. Folded integers keep the type of the expression they replace, untyped literal
+// arithmetic is evaluated exactly and stays untyped.
+//
+// Runs after lifetime analysis, so code that is never executed is still checked.
+void fold_statements(std::vector<aast::Statement *> &statements);
+aast::Expression *fold_expression(aast::Expression *expression);
+
+#endif //TARIK_SRC_SEMANTIC_FOLDING_H
@@ -58,13 +58,13 @@ ast::Expression *ExternMacro<VARIABLE_ARGS>::apply(Analyser *analyser,
                 ->note(ex->path.origin, "previous definition here");
     }
 
-    analyser->func_decls.emplace(func_path,
-                                 new aast::FuncDeclareStatement(macro_call->origin,
-                                                                func_path,
-                                                                func_path.name(),
-                                                                return_type,
-                                                                func_args,
-                                                                VARIABLE_ARGS));
+    analyser->add_func_decl(func_path,
+                            new aast::FuncDeclareStatement(macro_call->origin,
+                                                           func_path,
+                                                           func_path.name(),
+                                                           return_type,
+                                                           func_args,
+                                                           VARIABLE_ARGS));
 
     return new ast::EmptyExpression(macro_call->origin);
 }
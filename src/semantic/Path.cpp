@@ -6,6 +6,11 @@
 
 #include "Path.h"
 
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "lexical/PermanentAllocator.h"
 #include "syntactic/ast/Expression.h"
 
 std::vector<std::string> flatten_path(ast::Expression *path) {
@@ -30,13 +35,85 @@ std::vector<std::string> flatten_path(ast::Expression *path) {
     return {};
 }
 
-Path::Path(std::vector<std::string> parts, LexerRange origin)
-    : parts(parts),
+namespace
+{
+struct ChildKey {
+    const void *parent;
+    Symbol part;
+
+    bool operator==(const ChildKey &other) const = default;
+};
+
+struct ChildKeyHash {
+    std::size_t operator()(const ChildKey &key) const noexcept {
+        return std::hash<const void *>()(key.parent) ^ std::hash<Symbol>()(key.part) * 0x9e3779b97f4a7c15ull;
+    }
+};
+}
+
+struct Path::Node {
+    const Node *parent;
+    Symbol part;
+    uint32_t depth;
+    // Whether any part of the path is '*'
+    bool pointer;
+    std::size_t hash;
+};
+
+const Path::Node *Path::root() {
+    static const Node node {nullptr, Symbol(), 0, false, 0xcbf29ce484222325ull};
+    return &node;
+}
+
+const Path::Node *Path::child(const Node *parent, Symbol part) {
+    // Nodes are never freed, like symbols, so they can be handed out without holding the lock
+    static std::shared_mutex mutex;
+    static std::unordered_map<ChildKey,
+                              const Node *,
+                              ChildKeyHash,
+                              std::equal_to<>,
+                              PermanentAllocator<std::pair<const ChildKey, const Node *>>> children;
+    static const Symbol pointer_part("*");
+
+    ChildKey key {parent, part};
+    {
+        std::shared_lock lock(mutex);
+        auto it = children.find(key);
+        if (it != children.end())
+            return it->second;
+    }
+
+    std::unique_lock lock(mutex);
+    auto it = children.find(key);
+    if (it != children.end())
+        return it->second;
+
+    auto *node = new (PermanentAllocator<Node>().allocate(1)) Node {
+        parent,
+        part,
+        parent->depth + 1,
+        parent->pointer || part == pointer_part,
+        (parent->hash ^ part.get_id()) * 0x100000001b3ull,
+    };
+    children.emplace(key, node);
+    return node;
+}
+
+Path::Path(const Node *node, bool global, LexerRange origin)
+    : node(node),
+      global(global),
+      origin(origin) {}
+
+Path::Path(const std::vector<std::string> &parts, LexerRange origin)
+    : node(root()),
       origin(origin) {
-    if (!this->parts.empty() && this->parts.front().empty()) {
-        this->parts.erase(this->parts.begin());
+    auto it = parts.begin();
+    if (it != parts.end() && it->empty()) {
+        ++it;
         global = true;
     }
+    for (; it != parts.end(); ++it)
+        node = child(node, Symbol(*it));
 }
 
 Path Path::from_expression(ast::Expression *path) {
@@ -44,6 +121,7 @@ Path Path::from_expression(ast::Expression *path) {
 }
 
 std::string Path::str() const {
+    std::vector<std::string> parts = get_parts();
     std::string res;
     for (auto it = parts.begin(); it != parts.end();) {
         if (it->empty()) {
@@ -59,6 +137,10 @@ std::string Path::str() const {
 }
 
 std::vector<std::string> Path::get_parts() const {
+    std::vector<std::string> parts(node->depth);
+    const Node *n = node;
+    for (auto it = parts.rbegin(); it != parts.rend(); ++it, n = n->parent)
+        *it = n->part.str();
     return parts;
 }
 
@@ -67,46 +149,41 @@ bool Path::is_global() const {
 }
 
 bool Path::contains_pointer() const {
-    return std::find(parts.begin(), parts.end(), "*") != parts.end();
+    return node->pointer;
 }
 
 Path Path::create_member(const std::string &name) const {
-    std::vector member_parts = parts;
-    member_parts.push_back(name);
-    return Path(member_parts, origin);
+    return Path(child(node, Symbol(name)), false, origin);
 }
 
 Path Path::create_member(Token token) const {
-    std::vector member_parts = parts;
-    member_parts.push_back(token.raw);
-    return Path(member_parts, token.origin);
+    return Path(child(node, token.symbol.empty() ? Symbol(token.raw) : token.symbol), false, token.origin);
 }
 
 Path Path::get_parent() const {
-    std::vector parent_parts = parts;
-    if (!parent_parts.empty())
-        parent_parts.pop_back();
-    return Path(parent_parts, origin);
+    return Path(node->parent ? node->parent : node, false, origin);
 }
 
 Path Path::with_prefix(Path prefix) const {
-    std::vector prefixed_parts = parts;
-    prefixed_parts.insert(prefixed_parts.begin(), prefix.parts.begin(), prefix.parts.end());
-    return Path(prefixed_parts, origin);
+    std::vector<Symbol> suffix(node->depth);
+    const Node *n = node;
+    for (auto it = suffix.rbegin(); it != suffix.rend(); ++it, n = n->parent)
+        *it = n->part;
+
+    const Node *prefixed = prefix.node;
+    for (Symbol part : suffix)
+        prefixed = child(prefixed, part);
+    return Path(prefixed, false, origin);
 }
 
 std::string Path::name() const {
-    return parts.back();
+    return std::string(node->part.str());
 }
 
 size_t Path::size() const {
-    return parts.size();
-}
-
-bool Path::operator==(const Path &other) const {
-    return parts == other.parts;
+    return node->depth;
 }
 
-bool Path::operator!=(const Path &other) const {
-    return parts != other.parts;
+std::size_t Path::hash() const {
+    return node->hash;
 }
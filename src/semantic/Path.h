@@ -18,14 +18,25 @@ class Expression;
 
 std::vector<std::string> flatten_path(ast::Expression *path);
 
+// A path like a::b::c. Paths are interned into a trie shared by the whole process, so copying, hashing and comparing
+// one is constant time, and so is taking its parent or a member. Interning is thread-safe.
+//
+// The origin is only carried alongside the interned part and doesn't take part in comparisons.
 class Path {
-    std::vector<std::string> parts;
+    struct Node;
+
+    const Node *node;
     bool global = false;
 
+    Path(const Node *node, bool global, LexerRange origin);
+
+    static const Node *root();
+    static const Node *child(const Node *parent, Symbol part);
+
 public:
     LexerRange origin;
 
-    explicit Path(std::vector<std::string> parts, LexerRange origin);
+    explicit Path(const std::vector<std::string> &parts, LexerRange origin);
 
     static Path from_expression(ast::Expression *path);
 
@@ -43,15 +54,16 @@ public:
     std::string name() const;
 
     size_t size() const;
+    std::size_t hash() const;
 
-    bool operator==(const Path &) const;
-    bool operator!=(const Path &) const;
+    bool operator==(const Path &other) const { return node == other.node; }
+    bool operator!=(const Path &other) const { return node != other.node; }
 };
 
 template <>
 struct std::hash<Path> {
     std::size_t operator()(const Path &k) const {
-        return std::hash<std::string>()(k.str());
+        return k.hash();
     }
 };
 
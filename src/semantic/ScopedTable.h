@@ -0,0 +1,83 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_SEMANTIC_SCOPEDTABLE_H
+#define TARIK_SRC_SEMANTIC_SCOPEDTABLE_H
+
+#include <vector>
+#include <optional>
+#include <unordered_map>
+
+// Symbol table for nested scopes. Lookups only see the innermost binding of each key, leaving a scope drops its
+// bindings and brings back whatever they shadowed.
+template <class Key, class Value>
+class ScopedTable {
+public:
+    struct Entry {
+        Key key;
+        Value value;
+        // Index of the entry this one shadows
+        std::optional<std::size_t> shadowed;
+    };
+
+private:
+    // Every binding of every open scope, innermost scope last
+    std::vector<Entry> entries;
+    std::unordered_map<Key, std::size_t> visible;
+    // Size of entries when each scope was opened
+    std::vector<std::size_t> scopes;
+
+public:
+    void push_scope() {
+        scopes.push_back(entries.size());
+    }
+
+    void pop_scope() {
+        std::size_t start = scopes.back();
+        scopes.pop_back();
+
+        while (entries.size() > start) {
+            Entry &entry = entries.back();
+            if (entry.shadowed.has_value())
+                visible[entry.key] = entry.shadowed.value();
+            else
+                visible.erase(entry.key);
+            entries.pop_back();
+        }
+    }
+
+    // Bind key to value in the innermost scope, shadowing any outer binding
+    void insert(const Key &key, Value value) {
+        auto [it, inserted] = visible.try_emplace(key, entries.size());
+        std::optional<std::size_t> shadowed;
+        if (!inserted) {
+            shadowed = it->second;
+            it->second = entries.size();
+        }
+        entries.push_back({key, std::move(value), shadowed});
+    }
+
+    const Value *find(const Key &key) const {
+        auto it = visible.find(key);
+        return it == visible.end() ? nullptr : &entries[it->second].value;
+    }
+
+    bool contains(const Key &key) const {
+        return visible.contains(key);
+    }
+
+    void clear() {
+        entries.clear();
+        visible.clear();
+        scopes.clear();
+    }
+
+    // All bindings of all open scopes, including shadowed ones, outermost first
+    auto begin() const { return entries.begin(); }
+    auto end() const { return entries.end(); }
+};
+
+#endif //TARIK_SRC_SEMANTIC_SCOPEDTABLE_H
@@ -6,189 +6,223 @@
 
 #include "Variables.h"
 
-VariableState::VariableState(bool undefined,
-                             bool defined,
-                             bool moved,
-                             LexerRange defined_pos)
-    : is_undefined(undefined),
-      was_defined(defined),
-      was_moved(moved),
-      defined_pos(defined_pos) {}
-
-void VariableState::make_definitely_defined(LexerRange pos) {
-    is_undefined = false;
-    was_defined = true;
-    was_moved = false;
-
-    defined_pos = pos;
-    moved_pos = LexerRange();
+#include <algorithm>
+
+bool VariableStates::test(const Bits &bits, uint32_t slot) {
+    return slot / 64 < bits.size() && (bits[slot / 64] >> (slot % 64) & 1);
+}
+
+void VariableStates::assign(Bits &bits, uint32_t slot, bool value) {
+    if (slot / 64 >= bits.size())
+        bits.resize(slot / 64 + 1);
+    if (value)
+        bits[slot / 64] |= uint64_t(1) << (slot % 64);
+    else
+        bits[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+}
+
+uint32_t VariableStates::add_slot() {
+    uint32_t slot = slots++;
+    assign(undefined, slot, true);
+    assign(defined, slot, false);
+    assign(moved, slot, false);
+    defined_pos.emplace_back();
+    moved_pos.emplace_back();
+    return slot;
+}
+
+void VariableStates::copy_slot(uint32_t from, uint32_t to) {
+    assign(undefined, to, test(undefined, from));
+    assign(defined, to, test(defined, from));
+    assign(moved, to, test(moved, from));
+    defined_pos[to] = defined_pos[from];
+    moved_pos[to] = moved_pos[from];
+
+    // The new slot has to look like it existed all along to scopes that are still open
+    for (std::size_t i = 0; i < depth; i++) {
+        Frame &frame = frames[i];
+        assign(frame.undefined, to, test(frame.undefined, from));
+        assign(frame.defined, to, test(frame.defined, from));
+        assign(frame.moved, to, test(frame.moved, from));
+
+        if (test(frame.saved, from)) {
+            auto it = std::ranges::find(frame.positions, from, [](const auto &saved) { return std::get<0>(saved); });
+            save_positions(frame, to, std::get<1>(*it), std::get<2>(*it));
+        }
+    }
 }
 
-void VariableState::make_definitely_read() {
-    is_undefined = false;
-    was_defined = false;
-    was_moved = false;
+void VariableStates::save_positions(Frame &frame, uint32_t slot, LexerRange defined_at, LexerRange moved_at) {
+    assign(frame.saved, slot, true);
+    frame.positions.emplace_back(slot, defined_at, moved_at);
+}
 
-    defined_pos = LexerRange();
-    moved_pos = LexerRange();
+void VariableStates::set_positions(uint32_t slot, LexerRange defined_at, LexerRange moved_at) {
+    if (depth > 0 && !test(frames[depth - 1].saved, slot))
+        save_positions(frames[depth - 1], slot, defined_pos[slot], moved_pos[slot]);
+    defined_pos[slot] = defined_at;
+    moved_pos[slot] = moved_at;
 }
 
-void VariableState::make_definitely_moved(LexerRange pos) {
-    is_undefined = false;
-    was_defined = false;
-    was_moved = true;
+void VariableStates::set_state(uint32_t slot, bool is_defined, bool is_moved, LexerRange pos) {
+    assign(undefined, slot, false);
+    assign(defined, slot, is_defined);
+    assign(moved, slot, is_moved);
 
-    defined_pos = LexerRange();
-    moved_pos = pos;
+    if (is_defined)
+        set_positions(slot, pos, moved_pos[slot]);
+    else if (is_moved)
+        set_positions(slot, defined_pos[slot], pos);
 }
 
-bool VariableState::is_definitely_undefined() const {
-    return is_undefined && !was_defined && !was_moved;
+void VariableStates::clear() {
+    undefined.clear();
+    defined.clear();
+    moved.clear();
+    defined_pos.clear();
+    moved_pos.clear();
+    depth = 0;
+    variables.clear();
+    slots = 0;
 }
 
-bool VariableState::is_definitely_defined() const {
-    return !is_undefined && was_defined && !was_moved;
+SemanticVariable *VariableStates::add(aast::VariableStatement *var) {
+    return &variables.emplace_back(var, add_slot());
 }
 
-bool VariableState::is_definitely_moved() const {
-    return !is_undefined && !was_defined && was_moved;
-}
+SemanticVariable *VariableStates::get_field(SemanticVariable *var,
+                                            const aast::StructStatement *struct_,
+                                            std::string_view name) {
+    if (!var->split) {
+        var->split = true;
+        for (auto *member : struct_->members) {
+            SemanticVariable &field = variables.emplace_back(member, add_slot());
+            copy_slot(var->slot, field.slot);
+            var->fields.push_back(&field);
+        }
+    }
 
-bool VariableState::is_maybe_undefined() const {
-    return is_undefined;
+    for (auto *field : var->fields) {
+        if (field->var->name.raw == name)
+            return field;
+    }
+    return nullptr;
 }
 
-bool VariableState::is_maybe_defined() const {
-    return was_defined;
-}
+void VariableStates::push_scope() {
+    if (depth == frames.size())
+        frames.emplace_back();
+    Frame &frame = frames[depth++];
 
-bool VariableState::is_maybe_moved() const {
-    return was_moved;
-}
+    frame.undefined = undefined;
+    frame.defined = defined;
+    frame.moved = moved;
+    frame.saved.assign(undefined.size(), 0);
+    frame.positions.clear();
 
-LexerRange VariableState::get_defined_pos() const {
-    return defined_pos;
+    // Values that are definitely defined when the scope is entered count as read inside of it
+    for (std::size_t i = 0; i < defined.size(); i++)
+        defined[i] &= undefined[i] | moved[i];
 }
 
-LexerRange VariableState::get_moved_pos() const {
-    return moved_pos;
-}
+void VariableStates::pop_scope(bool always_executed) {
+    Frame &frame = frames[--depth];
+    Frame *outer = depth > 0 ? &frames[depth - 1] : nullptr;
 
-VariableState VariableState::operator||(const VariableState &other) const {
-    return VariableState(is_undefined || other.is_undefined,
-                         was_defined || other.was_defined,
-                         was_moved || other.was_moved,
-                         (defined_pos > other.defined_pos ? defined_pos : other.defined_pos));
-}
+    for (const auto &[slot, old_defined_pos, old_moved_pos] : frame.positions) {
+        // The enclosing scope wrote these slots too now, so it needs to know what they were before
+        if (outer && !test(outer->saved, slot))
+            save_positions(*outer, slot, old_defined_pos, old_moved_pos);
+
+        if (always_executed)
+            continue;
 
-CompoundState::CompoundState(const std::vector<SemanticVariable *> &states)
-    : children(states) {}
+        // Keep the latest position of the paths that actually leave the slot defined or moved
+        if (test(frame.defined, slot) && (!test(defined, slot) || old_defined_pos > defined_pos[slot]))
+            defined_pos[slot] = old_defined_pos;
+        if (test(frame.moved, slot) && (!test(moved, slot) || old_moved_pos > moved_pos[slot]))
+            moved_pos[slot] = old_moved_pos;
+    }
 
+    if (always_executed)
+        return;
 
-void CompoundState::make_definitely_defined(LexerRange pos) {
-    VariableState::make_definitely_defined(pos);
-    for (auto *child : children) {
-        child->state()->make_definitely_defined(pos);
+    // Variables declared inside the scope aren't in the frame, but they also went out of scope with it
+    for (std::size_t i = 0; i < frame.undefined.size(); i++) {
+        undefined[i] |= frame.undefined[i];
+        defined[i] |= frame.defined[i];
+        moved[i] |= frame.moved[i];
     }
 }
 
-void CompoundState::make_definitely_read() {
-    VariableState::make_definitely_read();
-    for (auto *child : children) {
-        child->state()->make_definitely_read();
-    }
+void VariableStates::make_definitely_defined(SemanticVariable *var, LexerRange pos) {
+    set_state(var->slot, true, false, pos);
+    for (auto *field : var->fields)
+        make_definitely_defined(field, pos);
 }
 
-void CompoundState::make_definitely_moved(LexerRange pos) {
-    VariableState::make_definitely_moved(pos);
-    for (auto *child : children) {
-        child->state()->make_definitely_moved(pos);
-    }
+void VariableStates::make_definitely_read(SemanticVariable *var) {
+    set_state(var->slot, false, false, LexerRange());
+    for (auto *field : var->fields)
+        make_definitely_read(field);
 }
 
-bool CompoundState::is_definitely_undefined() const {
-    bool state = false;
-    for (auto *child : children) {
-        state = state || child->state()->is_definitely_undefined();
-    }
-    return state;
+void VariableStates::make_definitely_moved(SemanticVariable *var, LexerRange pos) {
+    set_state(var->slot, false, true, pos);
+    for (auto *field : var->fields)
+        make_definitely_moved(field, pos);
 }
 
-bool CompoundState::is_definitely_defined() const {
+bool VariableStates::is_definitely_undefined(const SemanticVariable *var) const {
+    if (var->split)
+        return std::ranges::any_of(var->fields, [this](auto *field) { return is_definitely_undefined(field); });
+    return test(undefined, var->slot) && !test(defined, var->slot) && !test(moved, var->slot);
+}
+
+bool VariableStates::is_definitely_defined(const SemanticVariable *var) const {
     // empty structs should also be moved, and not be copy implicitly (even though there is no data to copy)
-    bool state = !children.empty();
-    for (auto *child : children) {
-        state = state && child->state()->is_definitely_defined();
-    }
-    return state;
+    if (var->split)
+        return !var->fields.empty() &&
+               std::ranges::all_of(var->fields, [this](auto *field) { return is_definitely_defined(field); });
+    return !test(undefined, var->slot) && test(defined, var->slot) && !test(moved, var->slot);
 }
 
-bool CompoundState::is_definitely_moved() const {
-    bool state = VariableState::is_definitely_moved();
+bool VariableStates::is_definitely_moved(const SemanticVariable *var) const {
     // if any of the structs children were moved, the struct is also
     // moved or, more specifically, is not available for moving anymore
-    for (auto *child : children) {
-        state = state || child->state()->is_definitely_moved();
-    }
-    return state;
+    bool own = !test(undefined, var->slot) && !test(defined, var->slot) && test(moved, var->slot);
+    return own || std::ranges::any_of(var->fields, [this](auto *field) { return is_definitely_moved(field); });
 }
 
-bool CompoundState::is_maybe_undefined() const {
-    bool state = false;
-    for (auto *child : children) {
-        state = state || child->state()->is_maybe_undefined();
-    }
-    return state;
+bool VariableStates::is_maybe_undefined(const SemanticVariable *var) const {
+    if (var->split)
+        return std::ranges::any_of(var->fields, [this](auto *field) { return is_maybe_undefined(field); });
+    return test(undefined, var->slot);
 }
 
-bool CompoundState::is_maybe_defined() const {
-    bool state = false;
-    for (auto *child : children) {
-        state = state || child->state()->is_maybe_defined();
-    }
-    return state;
+bool VariableStates::is_maybe_defined(const SemanticVariable *var) const {
+    if (var->split)
+        return std::ranges::any_of(var->fields, [this](auto *field) { return is_maybe_defined(field); });
+    return test(defined, var->slot);
 }
 
-bool CompoundState::is_maybe_moved() const {
-    bool state = was_moved;
-    for (auto *child : children) {
-        state = state || child->state()->is_maybe_moved();
-    }
-    return state;
+bool VariableStates::is_maybe_moved(const SemanticVariable *var) const {
+    return test(moved, var->slot) ||
+           std::ranges::any_of(var->fields, [this](auto *field) { return is_maybe_moved(field); });
 }
 
-LexerRange CompoundState::get_defined_pos() const {
-    return defined_pos;
+LexerRange VariableStates::get_defined_pos(const SemanticVariable *var) const {
+    return defined_pos[var->slot];
 }
 
-LexerRange CompoundState::get_moved_pos() const {
-    LexerRange pos = moved_pos;
-    for (auto *child : children) {
-        if (!child->state()->is_maybe_moved())
+LexerRange VariableStates::get_moved_pos(const SemanticVariable *var) const {
+    LexerRange pos = test(moved, var->slot) ? moved_pos[var->slot] : LexerRange();
+    for (auto *field : var->fields) {
+        if (!is_maybe_moved(field))
             continue;
-        LexerRange child_pos = child->state()->get_moved_pos();
-        if (child->state()->get_moved_pos() > pos)
-            pos = child_pos;
+        LexerRange field_pos = get_moved_pos(field);
+        if (field_pos > pos)
+            pos = field_pos;
     }
     return pos;
 }
-
-VariableState CompoundState::operator||(const VariableState &) const {
-    return *this;
-}
-
-VariableState *PrimitiveVariable::state() {
-    return &state_stack.top();
-}
-
-void PrimitiveVariable::pop_state() {
-    state_stack.pop();
-}
-
-void PrimitiveVariable::push_state(VariableState state) {
-    state_stack.push(state);
-}
-
-VariableState *CompoundVariable::state() {
-    return &compound_state;
-}
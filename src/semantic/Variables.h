@@ -7,98 +7,93 @@
 #ifndef TARIK_SRC_SEMANTIC_VARIABLES_H
 #define TARIK_SRC_SEMANTIC_VARIABLES_H
 
-#include <stack>
+#include <deque>
+#include <tuple>
+#include <vector>
+#include <cstdint>
 
 #include "lexical/Token.h"
 #include "semantic/ast/Statements.h"
 
-class VariableState {
-protected:
-    bool is_undefined = true, was_defined = false, was_moved = false;
-    LexerRange defined_pos, moved_pos;
-
-    VariableState(bool undefined, bool defined, bool moved, LexerRange defined_pos);
-
-public:
-    VariableState() = default;
-    virtual ~VariableState() = default;
-
-    virtual void make_definitely_defined(LexerRange pos);
-    virtual void make_definitely_read();
-    virtual void make_definitely_moved(LexerRange pos);
-
-    virtual bool is_definitely_undefined() const;
-    virtual bool is_definitely_defined() const;
-    virtual bool is_definitely_moved() const;
-
-    virtual bool is_maybe_undefined() const;
-    virtual bool is_maybe_defined() const;
-    virtual bool is_maybe_moved() const;
-
-    virtual LexerRange get_defined_pos() const;
-    virtual LexerRange get_moved_pos() const;
-
-    virtual VariableState operator||(const VariableState &other) const;
-};
-
 struct SemanticVariable {
+    // For fields, the member of the struct
     aast::VariableStatement *var;
-
-    SemanticVariable(aast::VariableStatement *var)
-        : var(var) {}
-
-    virtual VariableState *state() = 0;
-    virtual void pop_state() = 0;
-    virtual void push_state(VariableState state) = 0;
+    // Where the variable's state lives in VariableStates
+    uint32_t slot;
+    // Structs are tracked as a whole until one of their fields is accessed on its own. From then on, they are split
+    // into one variable per field, and the struct's state is made up from theirs.
+    bool split = false;
+    std::vector<SemanticVariable *> fields;
+
+    SemanticVariable(aast::VariableStatement *var, uint32_t slot)
+        : var(var),
+          slot(slot) {}
 };
 
-struct CompoundState : VariableState {
-    std::vector<SemanticVariable *> children;
+// Which variables of a function are defined, read or moved at the current point of the analysis. Every variable has
+// a slot with one bit in each of three dense bitsets, so entering and leaving scopes copies and joins a few words per
+// 64 variables instead of walking all of them.
+//
+// A variable is undefined until it's first assigned, defined until it's read, and moved once it was passed on. Where
+// control flow merges, bits of all paths are or-ed together, so a variable might be several of those at once.
+class VariableStates {
+    using Bits = std::vector<uint64_t>;
 
-    CompoundState(const std::vector<SemanticVariable *> &states);
+    struct Frame {
+        Bits undefined, defined, moved;
+        // Positions of slots written in this scope, as they were when it was entered
+        Bits saved;
+        std::vector<std::tuple<uint32_t, LexerRange, LexerRange>> positions;
+    };
 
-    void make_definitely_defined(LexerRange pos) override;
-    void make_definitely_read() override;
-    void make_definitely_moved(LexerRange pos) override;
+    Bits undefined, defined, moved;
+    // Only meaningful while the matching bit is set
+    std::vector<LexerRange> defined_pos, moved_pos;
 
-    bool is_definitely_undefined() const override;
-    bool is_definitely_defined() const override;
-    bool is_definitely_moved() const override;
+    // Reused between scopes, only the first depth frames are open
+    std::vector<Frame> frames;
+    std::size_t depth = 0;
 
-    bool is_maybe_undefined() const override;
-    bool is_maybe_defined() const override;
-    bool is_maybe_moved() const override;
+    std::deque<SemanticVariable> variables;
+    uint32_t slots = 0;
 
-    LexerRange get_defined_pos() const override;
-    LexerRange get_moved_pos() const override;
+    static bool test(const Bits &bits, uint32_t slot);
+    static void assign(Bits &bits, uint32_t slot, bool value);
 
-    VariableState operator||(const VariableState &other) const override;
-};
+    uint32_t add_slot();
+    void copy_slot(uint32_t from, uint32_t to);
+    void save_positions(Frame &frame, uint32_t slot, LexerRange defined_at, LexerRange moved_at);
+    void set_positions(uint32_t slot, LexerRange defined_at, LexerRange moved_at);
 
-class PrimitiveVariable : public SemanticVariable {
-    std::stack<VariableState> state_stack;
+    void set_state(uint32_t slot, bool is_defined, bool is_moved, LexerRange pos);
 
 public:
-    PrimitiveVariable(aast::VariableStatement *var)
-        : SemanticVariable(var),
-          state_stack({VariableState()}) {}
+    // Forget all variables, for the next function
+    void clear();
 
-    VariableState *state() override;
-    void pop_state() override;
-    void push_state(VariableState state) override;
-};
+    // A new variable, definitely undefined
+    SemanticVariable *add(aast::VariableStatement *var);
+    // Field name of var, splitting var if it wasn't already. Fields start out in the state var was in.
+    SemanticVariable *get_field(SemanticVariable *var, const aast::StructStatement *struct_, std::string_view name);
 
-class CompoundVariable : public SemanticVariable {
-    CompoundState compound_state;
+    void push_scope();
+    // Merge the state at the end of the scope with the one it was entered in, unless the scope is always executed
+    void pop_scope(bool always_executed);
 
-public:
-    CompoundVariable(aast::VariableStatement *var, const std::vector<SemanticVariable *> &states)
-        : SemanticVariable(var),
-          compound_state(states) {}
+    void make_definitely_defined(SemanticVariable *var, LexerRange pos);
+    void make_definitely_read(SemanticVariable *var);
+    void make_definitely_moved(SemanticVariable *var, LexerRange pos);
+
+    bool is_definitely_undefined(const SemanticVariable *var) const;
+    bool is_definitely_defined(const SemanticVariable *var) const;
+    bool is_definitely_moved(const SemanticVariable *var) const;
+
+    bool is_maybe_undefined(const SemanticVariable *var) const;
+    bool is_maybe_defined(const SemanticVariable *var) const;
+    bool is_maybe_moved(const SemanticVariable *var) const;
 
-    VariableState *state() override;
-    void pop_state() override {}
-    void push_state(VariableState) override {}
+    LexerRange get_defined_pos(const SemanticVariable *var) const;
+    LexerRange get_moved_pos(const SemanticVariable *var) const;
 };
 
 #endif //TARIK_SRC_SEMANTIC_VARIABLES_H
@@ -10,6 +10,7 @@
 #include <string>
 #include <utility>
 
+#include "Arena.h"
 #include "lexical/Lexer.h"
 #include "syntactic/Types.h"
 
@@ -32,6 +33,8 @@ enum StmtType {
     EXPR_STMT
 };
 
+// Nodes live in the Arena that is current while they are created. Children aren't owned by their parents, the arena
+// destroys every node when it is released.
 class Statement {
 public:
     StmtType statement_type {};
@@ -51,6 +54,15 @@ public:
 
     virtual ~Statement() = default;
 
+    // The finalizer is registered with the memory, so a node that fails to construct isn't destroyed by the arena a
+    // second time. The language calls operator delete for it, which drops the registration again.
+    static void *operator new(std::size_t size) {
+        return Arena::current().allocate_finalized(size, [](void *node) {
+            static_cast<Statement *>(node)->~Statement();
+        });
+    }
+    static void operator delete(void *node) { Arena::cancel_release(node); }
+
     [[nodiscard]] virtual std::string print() const = 0;
 };
 
@@ -75,20 +87,24 @@ enum ExprType {
 class Expression : public Statement {
 public:
     ExprType expression_type;
-    Type type;
-    std::vector<Statement *> prelude;
+    TypeId type;
 
-    explicit Expression(ExprType t, const LexerRange &lp, const Type &type, std::vector<Statement *> p = {})
+    explicit Expression(ExprType t, const LexerRange &lp, TypeId type)
         : Statement(EXPR_STMT, lp),
-          type(type),
-          prelude(std::move(p)) {
+          type(type) {
         expression_type = t;
     }
 
     virtual bool flattens_to_member_access() const { return false; }
     virtual std::string flatten_to_member_access() const { return "<>"; }
     virtual Expression *get_inner() { return this; }
-    virtual std::vector<Statement *> collect_prelude() { return prelude; }
+    // Statements that have to run before this expression itself. Only variable expressions, that struct initialisers
+    // are lowered to, have any, so they're not stored on every node.
+    virtual const std::vector<Statement *> &get_prelude() const {
+        static const std::vector<Statement *> none;
+        return none;
+    }
+    virtual std::vector<Statement *> collect_prelude() { return get_prelude(); }
 };
 } // namespace ast
 
@@ -39,13 +39,19 @@ public:
 class VariableExpression : public Expression {
 public:
     class VariableStatement *var;
+    std::vector<Statement *> prelude;
 
     explicit VariableExpression(const LexerRange &lp, VariableStatement *var, std::vector<Statement *> p = {})
-        : Expression(VAR_EXPR, lp, var->type, p),
-          var(var) {}
+        : Expression(VAR_EXPR, lp, var->type),
+          var(var),
+          prelude(std::move(p)) {}
+
+    const std::vector<Statement *> &get_prelude() const override {
+        return prelude;
+    }
 
     [[nodiscard]] std::string print() const override {
-        return var->name.raw;
+        return std::string(var->name.raw);
     }
 
     bool flattens_to_member_access() const override {
@@ -53,7 +59,7 @@ public:
     }
 
     std::string flatten_to_member_access() const override {
-        return var->name.raw;
+        return std::string(var->name.raw);
     }
 };
 
@@ -76,9 +82,14 @@ public:
     PrimitiveType n;
 
     PrimitiveExpression(const LexerRange &lp, PrimitiveType n)
-        : Expression(expr_type, lp, Type(size, pointer_level)),
+        : Expression(expr_type, lp, literal_type()),
           n(n) {}
 
+    static TypeId literal_type() {
+        static const TypeId type = Type(size, pointer_level);
+        return type;
+    }
+
     [[nodiscard]] std::string print() const override {
         return smart_cast_to_string(n);
     }
@@ -116,15 +127,11 @@ public:
     PrefixType prefix_type;
     Expression *operand;
 
-    explicit PrefixExpression(const LexerRange &lp, const Type &type, PrefixType pt, Expression *op)
-        : Expression(PREFIX_EXPR, lp, std::move(type)),
+    explicit PrefixExpression(const LexerRange &lp, TypeId type, PrefixType pt, Expression *op)
+        : Expression(PREFIX_EXPR, lp, type),
           prefix_type(pt),
           operand(op) {}
 
-    ~PrefixExpression() override {
-        delete operand;
-    }
-
     [[nodiscard]] std::string print() const override {
         return to_string(prefix_type) + operand->print();
     }
@@ -210,17 +217,12 @@ public:
     BinOpType bin_op_type;
     Expression *left, *right;
 
-    BinaryExpression(const LexerRange &, const Type &type, BinOpType bot, Expression *l, Expression *r)
+    BinaryExpression(const LexerRange &, TypeId type, BinOpType bot, Expression *l, Expression *r)
         : Expression(to_expr_type(bot), l->origin + r->origin, type),
           bin_op_type(bot),
           left(l),
           right(r) {}
 
-    ~BinaryExpression() override {
-        delete left;
-        delete right;
-    }
-
     [[nodiscard]] std::string print() const override {
         return "(" + left->print() + to_string(bin_op_type) + right->print() + ")";
     }
@@ -248,16 +250,12 @@ class CastExpression : public Expression {
 public:
     Expression *expression;
 
-    CastExpression(const LexerRange &lp, const Type &target_type, Expression *expr)
+    CastExpression(const LexerRange &lp, TypeId target_type, Expression *expr)
         : Expression(CAST_EXPR, lp, target_type),
           expression(expr) {}
 
-    ~CastExpression() override {
-        delete expression;
-    }
-
     [[nodiscard]] std::string print() const override {
-        return "as!(" + expression->print() + ", " + type.str() + ")";
+        return "as!(" + expression->print() + ", " + type->str() + ")";
     }
 
     std::vector<Statement *> collect_prelude() override {
@@ -270,18 +268,11 @@ public:
     Expression *callee;
     std::vector<Expression *> arguments;
 
-    CallExpression(const LexerRange &lp, const Type &type, Expression *c, std::vector<Expression *> args)
+    CallExpression(const LexerRange &lp, TypeId type, Expression *c, std::vector<Expression *> args)
         : Expression(CALL_EXPR, lp, type),
           callee(c),
           arguments(std::move(args)) {}
 
-    ~CallExpression() override {
-        for (auto *arg : arguments) {
-            delete arg;
-        }
-        delete callee;
-    }
-
     [[nodiscard]] std::string print() const override {
         std::string arg_string;
         for (auto *arg : arguments) {
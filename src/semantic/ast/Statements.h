@@ -25,12 +25,6 @@ public:
         : Statement(t, o),
           block(std::move(b)) {}
 
-    ~ScopeStatement() override {
-        for (auto *st : block) {
-            delete st;
-        }
-    }
-
     static std::string print_statements(std::vector<Statement *> stmts, bool indent = true) {
         std::string res;
         for (auto *st : stmts) {
@@ -92,11 +86,6 @@ public:
         : ScopeStatement(IF_STMT, o, std::move(block)),
           condition(cond) {}
 
-    ~IfStatement() override {
-        delete condition;
-        delete else_statement;
-    }
-
     [[nodiscard]] std::string print() const override {
         std::string prelude = print_statements(condition->collect_prelude(), false);
         std::string then_string = ScopeStatement::print();
@@ -116,10 +105,6 @@ public:
         : Statement(RETURN_STMT, o),
           value(val) {}
 
-    ~ReturnStatement() override {
-        delete value;
-    }
-
     [[nodiscard]] std::string print() const override {
         if (value) {
             std::string prelude = ScopeStatement::print_statements(value->collect_prelude(), false);
@@ -139,10 +124,6 @@ public:
         : ScopeStatement(WHILE_STMT, o, std::move(block)),
           condition(cond) {}
 
-    ~WhileStatement() override {
-        delete condition;
-    }
-
     [[nodiscard]] std::string print() const override {
         std::string prelude = print_statements(condition->collect_prelude(), false);
         std::string then_string = ScopeStatement::print();
@@ -182,7 +163,7 @@ public:
           name(std::move(n)) {}
 
     [[nodiscard]] std::string print() const override {
-        return type.str() + " " + name.raw + ";";
+        return type.str() + " " + std::string(name.raw) + ";";
     }
 };
 
@@ -202,7 +183,7 @@ public:
     [[nodiscard]] std::string head() const {
         std::string res = "fn " + path.str() + "(";
         for (auto *arg : arguments) {
-            res += arg->type.str() + " " + arg->name.raw + ", ";
+            res += arg->type.str() + " " + std::string(arg->name.raw) + ", ";
         }
 
         if (var_arg)
@@ -258,12 +239,6 @@ public:
         : ScopeStatement(FUNC_STMT, o, std::move(b)),
           FuncStCommon(std::move(p), std::move(ret), std::move(args), var_arg) {}
 
-    ~FuncStatement() override {
-        for (auto *arg : arguments) {
-            delete arg;
-        }
-    }
-
     [[nodiscard]] std::string print() const override {
         return head() + " " + ScopeStatement::print();
     }
@@ -294,12 +269,6 @@ public:
         : StructDeclareStatement(o, std::move(p), STRUCT_STMT),
           members(std::move(m)) {}
 
-    ~StructStatement() override {
-        for (auto *m : members) {
-            delete m;
-        }
-    }
-
     bool has_member(const std::string &n) {
         for (auto *mem : members) {
             if (mem->name.raw == n)
@@ -6,19 +6,48 @@
 
 #include "Parser.h"
 
+#include <algorithm>
+#include <unordered_map>
+
+#include "Arena.h"
+#include "ThreadPool.h"
 #include "ast/Parslets.h"
+#include "tlib/ModuleCache.h"
 
 using namespace ast;
 
-std::vector<std::filesystem::path> Parser::imported;
+// An imported file. Its parser runs on a worker thread, so it reports into its own bucket and allocates its nodes
+// from its own arena, both of which are merged into the main file's once parsing is done.
+struct Parser::Module {
+    std::filesystem::path file;
+    // Null if the file couldn't be read
+    const SourceFile *source = nullptr;
+    Bucket bucket;
+    Arena arena;
+    // A module is either parsed or decoded from the module cache
+    std::unique_ptr<Parser> parser;
+    std::optional<ModuleCache::Entry> cached;
+    std::vector<Statement *> statements;
+    LocalImports imports;
+};
+
+struct Parser::ImportGraph {
+    // Canonical path of the main file, if it is one
+    std::optional<std::filesystem::path> root;
+    const ModuleCache *cache = nullptr;
+    // Keyed by canonical path. All files are discovered before the first one is parsed, so the map is only read
+    // while parsers run concurrently.
+    std::unordered_map<std::filesystem::path, std::unique_ptr<Module>> modules;
+    // Modules in the order they were discovered in, which is also the order their files were loaded in
+    std::vector<Module *> order;
+};
 
 Precedence Parser::get_precedence() {
-    if (lexer.peek().id == SEMICOLON) {
+    TokenType next = lexer.peek().id;
+    if (next == SEMICOLON) {
         return static_cast<Precedence>(-1);
     }
-    if (infix_parslets.count(lexer.peek().id) > 0)
-        return infix_parslets.at(lexer.peek().id)->get_type();
-    return static_cast<Precedence>(0);
+    return infix_parslets[next].precedence;
 }
 
 std::vector<Statement *> Parser::block() {
@@ -33,115 +62,115 @@ std::vector<Statement *> Parser::block() {
     return res;
 }
 
-std::optional<Type> Parser::type() {
-    int peek_distance = 0;
+int Parser::match_type(int dist) const {
+    int start = dist;
+
+    TokenType first = lexer.peek(dist).id;
+    if (first == TYPE) {
+        dist++;
+    } else if (first == NAME || first == DOUBLE_COLON) {
+        if (first == NAME)
+            dist++;
+        while (lexer.peek(dist).id == DOUBLE_COLON) {
+            if (lexer.peek(dist + 1).id != NAME)
+                return 0;
+            dist += 2;
+        }
+    } else {
+        return 0;
+    }
 
-    Token peek = lexer.peek(peek_distance++);
-    if (peek.id != TYPE && peek.id != NAME && peek.id != DOUBLE_COLON)
+    while (lexer.peek(dist).id == ASTERISK)
+        dist++;
+
+    return dist - start;
+}
+
+std::optional<Type> Parser::type() {
+    if (match_type() == 0)
         return {};
+
+    Token first = lexer.peek();
     Type t;
 
-    if (peek.id == TYPE) {
-        TypeSize size = to_typesize(peek.raw);
-        bucket->error(peek.origin, "internal: couldn't find enum member for built-in type")
+    if (first.id == TYPE) {
+        lexer.consume();
+        TypeSize size = to_typesize(std::string(first.raw));
+        bucket->error(first.origin, "internal: couldn't find enum member for built-in type")
               ->assert(size != (TypeSize) -1);
         t = Type(size);
     } else {
-        LexerRange range = peek.origin;
-        std::vector path = {peek.raw};
-        if (peek.id == DOUBLE_COLON) {
-            path = {""};
-            peek_distance--;
+        LexerRange range = first.origin;
+        std::vector<std::string> path = {""};
+        if (first.id == NAME) {
+            path = {std::string(first.raw)};
+            lexer.consume();
         }
 
-        while (lexer.peek(peek_distance++).id == DOUBLE_COLON) {
-            Token part = lexer.peek(peek_distance++);
-            if (part.id == NAME) {
-                path.push_back(part.raw);
-                range = range + part.origin;
-            } else {
-                return {};
-            }
+        while (lexer.peek().id == DOUBLE_COLON) {
+            lexer.consume();
+            Token part = lexer.consume();
+            path.emplace_back(part.raw);
+            range = range + part.origin;
         }
 
-        peek_distance--;
-
         t = Type(Path(path, range));
     }
-    while (lexer.peek(peek_distance++).id == ASTERISK) {
+    while (lexer.peek().id == ASTERISK) {
+        lexer.consume();
         t.pointer_level++;
     }
 
-    peek_distance--;
-
-    for (int _ = 0; _ < peek_distance; _++)
-        lexer.consume();
-
     return t;
 }
 
-void Parser::init_parslets() {
-    // Trivial expressions
-    prefix_parslets.emplace(NAME, new NameParselet());
-    prefix_parslets.emplace(MACRO_NAME, new MacroNameParselet());
-    prefix_parslets.emplace(INTEGER, new IntParselet());
-    prefix_parslets.emplace(REAL, new RealParselet());
-    prefix_parslets.emplace(STRING, new StringParselet());
-    // This uses a tiny bit more memory, but saves us from a double free mess
-    prefix_parslets.emplace(TRUE, new BoolParselet());
-    prefix_parslets.emplace(FALSE, new BoolParselet());
-
-    // Prefix expressions
-    prefix_parslets.emplace(MINUS, new NegParselet());
-    prefix_parslets.emplace(AMPERSAND, new RefParselet());
-    prefix_parslets.emplace(ASTERISK, new DerefParselet());
-    prefix_parslets.emplace(NOT, new NotParselet());
-    prefix_parslets.emplace(DOUBLE_COLON, new GlobalParselet());
-    prefix_parslets.emplace(PAREN_OPEN, new GroupParselet());
-    prefix_parslets.emplace(BRACKET_OPEN, new ListParselet());
-
-    // Binary expressions
-    infix_parslets.emplace(DOUBLE_COLON, new PathParselet());
-    infix_parslets.emplace(PLUS, new AddParselet());
-    infix_parslets.emplace(MINUS, new SubParselet());
-    infix_parslets.emplace(ASTERISK, new MulParselet());
-    infix_parslets.emplace(SLASH, new DivParselet());
-    infix_parslets.emplace(DOUBLE_EQUAL, new EqParselet());
-    infix_parslets.emplace(NOT_EQUAL, new NeqParselet());
-    infix_parslets.emplace(SMALLER, new SmParselet());
-    infix_parslets.emplace(GREATER, new GrParselet());
-    infix_parslets.emplace(SMALLER_EQUAL, new SeParselet());
-    infix_parslets.emplace(GREATER_EQUAL, new GeParselet());
-    infix_parslets.emplace(PERIOD, new MemberAccessParselet());
-
-    // Call
-    infix_parslets.emplace(PAREN_OPEN, new CallParselet());
-    infix_parslets.emplace(BRACKET_OPEN, new StructInitParselet());
-
-    // Assign expressions
-    infix_parslets.emplace(EQUAL, new AssignParselet());
+void Parser::check_encoding() {
+    const SourceFile &file = SourceManager::get(lexer.get_file());
+    std::size_t offset = file.get_invalid_utf8();
+    bucket->error(LexerRange {{file.get_id(), (uint32_t) offset}, 1}, "source file is not valid UTF-8")
+          ->assert(offset == std::string_view::npos);
 }
 
 Parser::Parser(std::istream *code, Bucket *bucket)
     : lexer(code),
-      bucket(bucket) {
-    init_parslets();
+      bucket(bucket),
+      own_graph(std::make_unique<ImportGraph>()),
+      graph(own_graph.get()) {
+    check_encoding();
 }
 
 Parser::Parser(const std::filesystem::path &f, Bucket *bucket)
+    : Parser(f, bucket, nullptr) {
+    own_graph = std::make_unique<ImportGraph>();
+    graph = own_graph.get();
+    graph->root = weakly_canonical(f);
+}
+
+Parser::Parser(const SourceFile *file, Bucket *bucket)
+    : Parser(file, bucket, nullptr) {
+    own_graph = std::make_unique<ImportGraph>();
+    graph = own_graph.get();
+    graph->root = weakly_canonical(std::filesystem::path(file->get_name()));
+}
+
+Parser::Parser(const std::filesystem::path &f, Bucket *bucket, ImportGraph *graph)
     : lexer(f),
-      bucket(bucket) {
-    imported.push_back(canonical(f));
-    init_parslets();
+      bucket(bucket),
+      base_directory(f.parent_path()),
+      graph(graph) {
+    check_encoding();
 }
 
-Parser::~Parser() {
-    for (auto [type, parselet] : prefix_parslets)
-        delete parselet;
-    for (auto [type, parselet] : infix_parslets)
-        delete parselet;
+Parser::Parser(const SourceFile *file, Bucket *bucket, ImportGraph *graph)
+    : lexer(file),
+      bucket(bucket),
+      base_directory(std::filesystem::path(file->get_name()).parent_path()),
+      graph(graph) {
+    check_encoding();
 }
 
+Parser::~Parser() = default;
+
 Token Parser::expect(TokenType raw) {
     std::string s = to_string(raw);
     Token peek = lexer.consume();
@@ -170,26 +199,180 @@ bool Parser::is_peek(TokenType raw) {
     return lexer.peek().id == raw;
 }
 
-ImportPath Parser::find_import() {
-    Token next = expect(NAME);
-
-    Path path = Path({next.raw}, next.origin);
+ImportPath Parser::resolve_import(const std::filesystem::path &base_directory, const Token &name) {
+    Path path = Path({std::string(name.raw)}, name.origin);
 
-    std::filesystem::path import_ = next.raw;
+    std::filesystem::path import_ = name.raw;
 
     import_.replace_extension(".tk");
 
-    if (exists(import_)) {
-        return {true, path, import_};
+    if (exists(base_directory / import_)) {
+        return {true, path, base_directory / import_};
     }
 
-    if (exists(next.raw / import_)) {
-        return {true, path.create_member(next.raw), next.raw / import_};
+    if (exists(base_directory / name.raw / import_)) {
+        return {true, path.create_member(std::string(name.raw)), base_directory / name.raw / import_};
     }
 
     return {false, path, {}};
 }
 
+ImportPath Parser::find_import() {
+    return resolve_import(base_directory, expect(NAME));
+}
+
+std::vector<Token> Parser::import_names() const {
+    // Every import statement is an import keyword followed by a name, so the token buffer already tells us which
+    // files this one needs
+    std::vector<Token> names;
+    const std::vector<Token> &tokens = lexer.get_tokens();
+    for (size_t i = 0; i + 1 < tokens.size(); i++) {
+        if (tokens[i].id == IMPORT && tokens[i + 1].id == NAME)
+            names.push_back(tokens[i + 1]);
+    }
+    return names;
+}
+
+void Parser::discover_imports(ThreadPool &pool) {
+    // Directory and import names of every file whose imports haven't been resolved yet
+    std::vector<std::pair<std::filesystem::path, std::vector<Token>>> pending = {{base_directory, import_names()}};
+
+    // Files are discovered breadth first, one wave of newly imported files at a time. Each wave is loaded here in
+    // source order, which keeps file IDs and with them the order of diagnostics stable, and then tokenised
+    // concurrently, since the imports of a file are only known once it is.
+    while (!pending.empty()) {
+        std::vector<Module *> wave;
+        for (const auto &[directory, names] : pending) {
+            for (const Token &name : names) {
+                ImportPath imp = resolve_import(directory, name);
+                if (imp.file.empty())
+                    continue;
+
+                std::filesystem::path key = canonical(imp.file);
+                if (key == graph->root || graph->modules.contains(key))
+                    continue;
+
+                auto *module = new Module();
+                graph->modules.emplace(key, module);
+                graph->order.push_back(module);
+                wave.push_back(module);
+
+                module->file = imp.file;
+                module->source = SourceManager::load(imp.file);
+                if (module->source && graph->cache)
+                    module->cached = graph->cache->find(*module->source);
+            }
+        }
+        pending.clear();
+
+        for (Module *module : wave) {
+            if (!module->cached && module->source)
+                pool.submit([this, module] {
+                    module->parser = std::unique_ptr<Parser>(new Parser(module->source, &module->bucket, graph));
+                });
+        }
+        pool.wait();
+
+        for (Module *module : wave) {
+            std::filesystem::path directory = module->file.parent_path();
+            if (module->cached) {
+                pending.emplace_back(directory, module->cached->imports);
+            } else {
+                // Let the lexer report why the file can't be read. This registers a new file, so it stays on this
+                // thread.
+                if (!module->parser)
+                    module->parser = std::unique_ptr<Parser>(new Parser(module->file, &module->bucket, graph));
+                pending.emplace_back(directory, module->parser->import_names());
+            }
+        }
+    }
+}
+
+void Parser::parse_module(ImportGraph *graph, Module &module) {
+    Arena::Guard arena_guard(module.arena);
+
+    if (module.cached) {
+        std::vector<ImportStatement *> imports;
+        if (ModuleCache::read(module.cached.value(), module.statements, imports)) {
+            // Where an import leads depends on the files around this one, not on its contents, so it isn't cached
+            std::filesystem::path directory = module.file.parent_path();
+            for (auto *import_ : imports) {
+                ImportPath imp = resolve_import(directory,
+                                                Token::name(import_->path.get_parts()[0], import_->path.origin));
+                import_->path = imp.path;
+                import_->local = imp.local;
+                if (!imp.file.empty())
+                    module.imports.emplace_back(import_, canonical(imp.file));
+            }
+            return;
+        }
+
+        // The entry is damaged, so parse the file after all
+        module.statements.clear();
+        module.parser = std::unique_ptr<Parser>(new Parser(module.source, &module.bucket, graph));
+    }
+
+    module.statements = module.parser->parse_statements();
+    module.imports = std::move(module.parser->local_imports);
+
+    // Only cache files that parse cleanly, so their diagnostics are reported every time
+    if (graph->cache && module.source && module.bucket.get_errors().empty())
+        graph->cache->store(*module.source, module.parser->import_names(), module.statements);
+}
+
+void Parser::claim_imports(const LocalImports &imports, std::unordered_set<std::filesystem::path> &claimed) {
+    for (auto [import_, key] : imports) {
+        // Only the first import of a file gets its statements, later ones stay empty
+        if (!claimed.insert(key).second)
+            continue;
+
+        auto it = graph->modules.find(key);
+        if (it == graph->modules.end())
+            continue;
+
+        Module *module = it->second.get();
+        import_->block = module->statements;
+        bucket->merge(module->bucket);
+        Arena::current().merge(module->arena);
+        claim_imports(module->imports, claimed);
+    }
+}
+
+std::vector<Statement *> Parser::parse_statements() {
+    std::vector<Statement *> statements;
+    do {
+        statements.push_back(parse_statement());
+    } while (statements.back());
+    statements.pop_back();
+    return statements;
+}
+
+void Parser::set_module_cache(const ModuleCache *cache) {
+    graph->cache = cache;
+}
+
+std::vector<Statement *> Parser::parse() {
+    // Files without imports don't need any workers
+    if (import_names().empty())
+        return parse_statements();
+
+    ThreadPool pool;
+    discover_imports(pool);
+
+    for (Module *module : graph->order)
+        pool.submit([this, module] { parse_module(graph, *module); });
+    // The main file is parsed on this thread in the meantime
+    std::vector<Statement *> statements = parse_statements();
+    pool.wait();
+
+    std::unordered_set<std::filesystem::path> claimed;
+    if (graph->root)
+        claimed.insert(graph->root.value());
+    claim_imports(local_imports, claimed);
+
+    return statements;
+}
+
 Expression *Parser::parse_expression(int precedence) {
     Token token = lexer.peek();
     if (token.id == END)
@@ -197,19 +380,16 @@ Expression *Parser::parse_expression(int precedence) {
     if (!bucket->error(token.origin,
                        "expected expression, found '{}'",
                        token.raw)
-               ->assert(prefix_parslets.contains(token.id)))
+               ->assert(prefix_parslets[token.id].parse))
         return new EmptyExpression(token.origin);
     lexer.consume();
-    PrefixParselet *prefix = prefix_parslets.at(token.id);
 
-    Expression *left = prefix->parse(this, token);
+    Expression *left = prefix_parslets[token.id].parse(this, token);
 
     while (precedence < get_precedence()) {
-        token = lexer.peek();
-
-        InfixParselet *infix = infix_parslets.at(token.id);
-        if (infix->can_parse(left))
-            left = infix->parse(this, lexer.consume(), left);
+        const InfixParselet &infix = infix_parslets[lexer.peek().id];
+        if (infix.can_parse(left))
+            left = infix.parse(this, lexer.consume(), left);
         else
             break;
     }
@@ -361,42 +541,24 @@ Statement *Parser::parse_statement() {
         lexer.consume();
 
         ImportPath imp = find_import();
-        std::vector<Statement *> statements;
-        if (!imp.file.empty()) {
-            if (std::find(imported.begin(), imported.end(), canonical(imp.file)) == imported.end()) {
-                Parser p(imp.file, bucket);
-                std::filesystem::path cwd = std::filesystem::current_path();
-                std::filesystem::current_path(canonical(imp.file).parent_path());
-                do {
-                    statements.push_back(p.parse_statement());
-                } while (statements.back());
-                statements.pop_back();
-                std::filesystem::current_path(cwd);
-            }
-        }
+        // The imported file is parsed separately, its statements are attached once all files are done
+        auto *import_ = new ImportStatement(token.origin, imp.path, imp.local, {});
+        if (!imp.file.empty())
+            local_imports.emplace_back(import_, canonical(imp.file));
         expect(SEMICOLON);
 
-        return new ImportStatement(token.origin, imp.path, imp.local, statements);
-    } else if (Token peek = lexer.peek(1); peek.id == NAME || peek.id == ASTERISK || peek.id == DOUBLE_COLON) {
-        Lexer::State state = lexer.checkpoint();
-        if (std::optional<Type> ty = type(); ty.has_value()) {
-            Type t = ty.value();
+        return import_;
+    } else if (int length = match_type(); length > 0 && lexer.peek(length).id == NAME) {
+        // A type followed by a name can only be a declaration
+        Type t = type().value();
+        Token name = lexer.peek();
 
-            Token peek = lexer.peek();
-
-            if (peek.id != NAME) {
-                lexer.rollback(state);
-            } else {
-                Token name = lexer.peek();
-
-                if (lexer.peek(1).id != EQUAL) {
-                    lexer.consume();
-                    expect(SEMICOLON);
-                }
-
-                return new VariableStatement(t, name);
-            }
+        if (lexer.peek(1).id != EQUAL) {
+            lexer.consume();
+            expect(SEMICOLON);
         }
+
+        return new VariableStatement(t, name);
     }
 
     Expression *e = parse_expression();
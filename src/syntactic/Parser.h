@@ -8,9 +8,11 @@
 #define TARIK_SRC_SYNTACTIC_PARSER_H_
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <optional>
 #include <filesystem>
+#include <unordered_set>
 
 #include "error/Bucket.h"
 #include "error/Error.h"
@@ -18,9 +20,8 @@
 #include "syntactic/ast/Expression.h"
 #include "syntactic/ast/Statements.h"
 
-class PrefixParselet;
-
-class InfixParselet;
+class ModuleCache;
+class ThreadPool;
 
 struct ImportPath {
     bool local;
@@ -29,15 +30,23 @@ struct ImportPath {
 };
 
 class Parser {
-    friend class CallParselet;
+    friend struct CallParselet;
 
-    static std::vector<std::filesystem::path> imported;
+    struct Module;
+    struct ImportGraph;
+    // Local import statements of a file in source order, with the canonical path of the imported file
+    using LocalImports = std::vector<std::pair<ast::ImportStatement *, std::filesystem::path>>;
 
     Lexer lexer;
     Bucket *bucket;
 
-    std::unordered_map<TokenType, PrefixParselet *> prefix_parslets;
-    std::unordered_map<TokenType, InfixParselet *> infix_parslets;
+    // Local imports are resolved relative to this, instead of the working directory
+    std::filesystem::path base_directory;
+    // Every local file reachable from the main file, shared by the parsers of all of them. Owned by the parser of the
+    // main file, the parsers of imported files are owned by the graph in turn and only point back to it.
+    std::unique_ptr<ImportGraph> own_graph;
+    ImportGraph *graph;
+    LocalImports local_imports;
 
     std::vector<std::filesystem::path> search_paths;
 
@@ -45,14 +54,27 @@ class Parser {
 
     std::vector<ast::Statement *> block();
 
+    // Number of tokens the type starting dist tokens ahead spans, or 0 if no type starts there. Only looks at the
+    // token buffer, so statements can be classified before anything is parsed.
+    int match_type(int dist = 0) const;
     std::optional<Type> type();
 
-    void init_parslets();
+    void check_encoding();
+
+    Parser(const std::filesystem::path &f, Bucket *bucket, ImportGraph *graph);
+    Parser(const SourceFile *file, Bucket *bucket, ImportGraph *graph);
+
+    static ImportPath resolve_import(const std::filesystem::path &base_directory, const Token &name);
+    std::vector<Token> import_names() const;
+    void discover_imports(ThreadPool &pool);
+    static void parse_module(ImportGraph *graph, Module &module);
+    void claim_imports(const LocalImports &imports, std::unordered_set<std::filesystem::path> &claimed);
+    std::vector<ast::Statement *> parse_statements();
 
 public:
     explicit Parser(std::istream *code, Bucket *bucket);
     explicit Parser(const std::filesystem::path &f, Bucket *bucket);
-
+    explicit Parser(const SourceFile *file, Bucket *bucket);
     ~Parser();
 
     Token expect(TokenType raw);
@@ -64,6 +86,13 @@ public:
     ast::Expression *parse_expression(int precedence = 0);
 
     ast::Statement *parse_statement();
+
+    // Reuse and store the syntax trees of imported files in cache. The cache has to outlive the call to parse().
+    void set_module_cache(const ModuleCache *cache);
+
+    // Parse the whole file, along with everything it imports locally. Imported files are parsed concurrently, their
+    // statements are attached to the first import of each file, the same as if they were parsed in place.
+    std::vector<ast::Statement *> parse();
 };
 
 #endif //TARIK_SRC_SYNTACTIC_PARSER_H_
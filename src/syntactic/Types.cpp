@@ -6,11 +6,134 @@
 
 #include "Types.h"
 
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
 
 #include "ast/Statements.h"
+#include "lexical/PermanentAllocator.h"
 #include "utf/Utf.h"
 
+namespace
+{
+class TypeTable {
+    static constexpr std::size_t CHUNK_BITS = 10;
+    static constexpr std::size_t CHUNK_SIZE = 1 << CHUNK_BITS;
+    static constexpr std::size_t MAX_CHUNKS = 1 << 16;
+    static constexpr uint32_t UNKNOWN = std::numeric_limits<uint32_t>::max();
+
+    struct Entry {
+        Type type;
+        // IDs of the derived types, filled in the first time they're asked for
+        std::atomic<uint32_t> pointer_to = UNKNOWN, deref = UNKNOWN;
+    };
+
+    std::shared_mutex mutex;
+    std::unordered_map<Type,
+                       uint32_t,
+                       std::hash<Type>,
+                       std::equal_to<>,
+                       PermanentAllocator<std::pair<const Type, uint32_t>>> ids;
+
+    // Types indexed by ID. Chunks never move once allocated, so they can be read without taking the lock, the same
+    // way symbols are.
+    std::array<std::atomic<Entry *>, MAX_CHUNKS> chunks {};
+    uint32_t next_id = 0;
+
+    Entry &entry(uint32_t id) const {
+        return chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)[id & (CHUNK_SIZE - 1)];
+    }
+
+    uint32_t derived(std::atomic<uint32_t> &cache, int pointer_offset, uint32_t id) {
+        uint32_t derived = cache.load(std::memory_order_relaxed);
+        if (derived == UNKNOWN) {
+            Type type = get(id);
+            type.pointer_level += pointer_offset;
+            // Racing threads all intern the same type, so whichever store wins is correct
+            derived = intern(type);
+            cache.store(derived, std::memory_order_relaxed);
+        }
+        return derived;
+    }
+
+public:
+    TypeTable() {
+        intern(Type(VOID));
+    }
+
+    uint32_t intern(const Type &type) {
+        {
+            std::shared_lock lock(mutex);
+            auto it = ids.find(type);
+            if (it != ids.end())
+                return it->second;
+        }
+
+        std::unique_lock lock(mutex);
+        auto it = ids.find(type);
+        if (it != ids.end())
+            return it->second;
+
+        uint32_t id = next_id++;
+        std::size_t chunk = id >> CHUNK_BITS;
+        if (chunk >= MAX_CHUNKS)
+            throw std::length_error("too many types");
+        if (!chunks[chunk].load(std::memory_order_relaxed)) {
+            // Kept out of the self test's leak detection, like the symbol table
+            Entry *entries = PermanentAllocator<Entry>().allocate(CHUNK_SIZE);
+            std::uninitialized_default_construct_n(entries, CHUNK_SIZE);
+            chunks[chunk].store(entries, std::memory_order_release);
+        }
+
+        chunks[chunk].load(std::memory_order_relaxed)[id & (CHUNK_SIZE - 1)].type = type;
+        ids.emplace(type, id);
+        return id;
+    }
+
+    const Type &get(uint32_t id) const {
+        return entry(id).type;
+    }
+
+    uint32_t pointer_to(uint32_t id) {
+        return derived(entry(id).pointer_to, 1, id);
+    }
+
+    uint32_t deref(uint32_t id) {
+        return derived(entry(id).deref, -1, id);
+    }
+};
+
+TypeTable &type_table() {
+    static TypeTable instance;
+    return instance;
+}
+}
+
+TypeId::TypeId(const Type &type)
+    : id(type_table().intern(type)) {}
+
+const Type &TypeId::get() const {
+    return type_table().get(id);
+}
+
+TypeId TypeId::get_pointer_to() const {
+    TypeId res;
+    res.id = type_table().pointer_to(id);
+    return res;
+}
+
+TypeId TypeId::get_deref() const {
+    TypeId res;
+    res.id = type_table().deref(id);
+    return res;
+}
+
 std::string Type::str() const {
     std::string res = base();
     if (pointer_level != 0) {
@@ -32,7 +155,21 @@ std::string Type::base() const {
 }
 
 std::string Type::func_name() const {
-    std::u32string base_str = to_utf(base());
+    std::string base_name = base();
+    if (is_ascii(base_name)) {
+        std::string res;
+        for (char c : base_name) {
+            if (c >= 'A' && c <= 'Z') {
+                if (!res.empty())
+                    res.push_back('_');
+                res.push_back((char) (c - 'A' + 'a'));
+            } else
+                res.push_back(c);
+        }
+        return res;
+    }
+
+    std::u32string base_str = to_utf(base_name);
     std::u32string res;
 
     std::locale en_US_UTF_8("en_US.UTF-8");
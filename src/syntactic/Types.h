@@ -352,6 +352,45 @@ public:
     [[nodiscard]] std::string func_name() const;
 };
 
+template <>
+struct std::hash<Type> {
+    std::size_t operator()(const Type &t) const noexcept {
+        std::size_t base = t.is_primitive() ? t.get_primitive() : std::hash<Path>()(t.get_user());
+        return base * 31 + t.pointer_level;
+    }
+};
+
+// A Type interned into the process-wide type table. IDs are 32 bit and compare like integers, two IDs are equal
+// exactly if their types are. The default ID is void.
+class TypeId {
+    uint32_t id = 0;
+
+public:
+    TypeId() = default;
+    TypeId(const Type &type);
+
+    [[nodiscard]] const Type &get() const;
+    [[nodiscard]] uint32_t get_id() const { return id; }
+
+    // Derived types are cached in the table, so after the first call these are a lookup
+    [[nodiscard]] TypeId get_pointer_to() const;
+    [[nodiscard]] TypeId get_deref() const;
+
+    const Type &operator*() const { return get(); }
+    const Type *operator->() const { return &get(); }
+    operator const Type &() const { return get(); }
+
+    bool operator==(const TypeId &other) const = default;
+    bool operator==(const Type &other) const { return get() == other; }
+};
+
+template <>
+struct std::hash<TypeId> {
+    std::size_t operator()(const TypeId &t) const noexcept {
+        return t.get_id();
+    }
+};
+
 template <>
 struct std::formatter<Type> : std::formatter<std::string> {
     auto format(Type t, std::format_context &ctx) const {
@@ -9,6 +9,7 @@
 
 #include <string>
 
+#include "Arena.h"
 #include "lexical/Lexer.h"
 #include "syntactic/Types.h"
 
@@ -29,6 +30,8 @@ enum StmtType {
     EXPR_STMT
 };
 
+// Nodes live in the Arena that is current while they are created. Children aren't owned by their parents, the arena
+// destroys every node when it is released.
 class Statement {
 public:
     StmtType statement_type {};
@@ -48,6 +51,15 @@ public:
 
     virtual ~Statement() = default;
 
+    // The finalizer is registered with the memory, so a node that fails to construct isn't destroyed by the arena a
+    // second time. The language calls operator delete for it, which drops the registration again.
+    static void *operator new(std::size_t size) {
+        return Arena::current().allocate_finalized(size, [](void *node) {
+            static_cast<Statement *>(node)->~Statement();
+        });
+    }
+    static void operator delete(void *node) { Arena::cancel_release(node); }
+
     [[nodiscard]] virtual std::string print() const = 0;
 };
 
@@ -137,10 +137,6 @@ public:
           prefix_type(pt),
           operand(op) {}
 
-    ~PrefixExpression() override {
-        delete operand;
-    }
-
     [[nodiscard]] std::string print() const override {
         return to_string(prefix_type) + operand->print();
     }
@@ -229,11 +225,6 @@ public:
           left(l),
           right(r) {}
 
-    ~BinaryExpression() override {
-        delete left;
-        delete right;
-    }
-
     [[nodiscard]] std::string print() const override {
         return "(" + left->print() + to_string(bin_op_type) + right->print() + ")";
     }
@@ -249,10 +240,6 @@ public:
           expression(expr),
           target_type(std::move(tt)) {}
 
-    ~CastExpression() override {
-        delete expression;
-    }
-
     [[nodiscard]] std::string print() const override {
         return expression->print() + ".as!(" + target_type.str() + ")";
     }
@@ -268,13 +255,6 @@ public:
           type(t),
           fields(std::move(f)) {}
 
-    ~StructInitExpression() override {
-        for (auto *arg : fields) {
-            delete arg;
-        }
-        delete type;
-    }
-
     [[nodiscard]] std::string print() const override {
         std::string arg_string;
         for (auto *arg : fields) {
@@ -298,13 +278,6 @@ public:
           callee(c),
           arguments(std::move(args)) {}
 
-    ~CallExpression() override {
-        for (auto *arg : arguments) {
-            delete arg;
-        }
-        delete callee;
-    }
-
     [[nodiscard]] std::string print() const override {
         std::string arg_string;
         for (auto *arg : arguments) {
@@ -326,12 +299,6 @@ public:
         : Expression(LIST_EXPR, lp),
           elements(elems) {}
 
-    ~ListExpression() override {
-        for (auto *elem : elements) {
-            delete elem;
-        }
-    }
-
     [[nodiscard]] std::string print() const override {
         std::string arg_string = "[";
         for (auto *arg : elements) {
@@ -7,30 +7,32 @@
 #ifndef TARIK_SRC_SYNTACTIC_EXPRESSIONS_PARSLETS_H_
 #define TARIK_SRC_SYNTACTIC_EXPRESSIONS_PARSLETS_H_
 
+#include <array>
+
 #include "Expression.h"
 #include "lexical/Token.h"
 #include "syntactic/Parser.h"
 
-class PrefixParselet {
-public:
-    virtual ast::Expression *parse(Parser *, const Token &) = 0;
-
-    virtual ~PrefixParselet() = default;
+// Parselets are stateless, so the parser dispatches through constant tables indexed by token type instead of
+// allocating handler objects. A missing entry has no parse function and, for infix parselets, precedence 0.
+struct PrefixParselet {
+    ast::Expression *(*parse)(Parser *, const Token &) = nullptr;
 };
 
-class InfixParselet {
-public:
-    virtual ast::Expression *parse(Parser *parser, const Token &, ast::Expression *left) = 0;
+struct InfixParselet {
+    ast::Expression *(*parse)(Parser *, const Token &, ast::Expression *left) = nullptr;
+    bool (*can_parse)(ast::Expression *) = nullptr;
+    ast::Precedence precedence = static_cast<ast::Precedence>(0);
+};
 
-    virtual bool can_parse(ast::Expression *) { return true; }
-    virtual ast::Precedence get_type() { return static_cast<ast::Precedence>(0); }
-    virtual ~InfixParselet() = default;
+struct AnyLeftParselet {
+    static bool can_parse(ast::Expression *) { return true; }
 };
 
 template <class SimpleExpression>
-class SimpleParselet : public PrefixParselet {
-    ast::Expression *parse(Parser *, const Token &token) override {
-        return (ast::Expression *) new SimpleExpression(token.origin, token.raw);
+struct SimpleParselet {
+    static ast::Expression *parse(Parser *, const Token &token) {
+        return (ast::Expression *) new SimpleExpression(token.origin, std::string(token.raw));
     }
 };
 
@@ -44,8 +46,8 @@ using MacroNameParselet = SimpleParselet<ast::MacroNameExpression>;
 
 
 template <ast::PrefixType prefix_type, ast::Precedence precedence = ast::PREFIX>
-class PrefixOperatorParselet : public PrefixParselet {
-    ast::Expression *parse(Parser *parser, const Token &token) override {
+struct PrefixOperatorParselet {
+    static ast::Expression *parse(Parser *parser, const Token &token) {
         ast::Expression *right = parser->parse_expression(precedence);
 
         return new ast::PrefixExpression(token.origin, prefix_type, right);
@@ -59,16 +61,14 @@ using NotParselet = PrefixOperatorParselet<ast::LOG_NOT>;
 using GlobalParselet = PrefixOperatorParselet<ast::GLOBAL, ast::NAME_CONCAT>;
 
 template <ast::BinOpType bot, ast::Precedence prec>
-class BinaryOperatorParselet : public InfixParselet {
-    ast::Expression *parse(Parser *parser, const Token &token, ast::Expression *left) override {
+struct BinaryOperatorParselet : AnyLeftParselet {
+    static constexpr ast::Precedence precedence = prec;
+
+    static ast::Expression *parse(Parser *parser, const Token &token, ast::Expression *left) {
         ast::Expression *right = parser->parse_expression(prec);
 
         return new ast::BinaryExpression(token.origin, bot, left, right);
     }
-
-    ast::Precedence get_type() override {
-        return prec;
-    }
 };
 
 using PathParselet = BinaryOperatorParselet<ast::PATH, ast::NAME_CONCAT>;
@@ -84,28 +84,28 @@ using SeParselet = BinaryOperatorParselet<ast::SME, ast::COMPARE>;
 using GeParselet = BinaryOperatorParselet<ast::GRE, ast::COMPARE>;
 using MemberAccessParselet = BinaryOperatorParselet<ast::MEM_ACC, ast::CALL>;
 
-class GroupParselet : public PrefixParselet {
-    ast::Expression *parse(Parser *parser, const Token &) override {
+struct GroupParselet {
+    static ast::Expression *parse(Parser *parser, const Token &) {
         ast::Expression *e = parser->parse_expression();
         parser->expect(PAREN_CLOSE);
         return e;
     }
 };
 
-class AssignParselet : public InfixParselet {
-    ast::Expression *parse(Parser *parser, const Token &token, ast::Expression *left) override {
+struct AssignParselet : AnyLeftParselet {
+    static constexpr ast::Precedence precedence = ast::ASSIGNMENT;
+
+    static ast::Expression *parse(Parser *parser, const Token &token, ast::Expression *left) {
         ast::Expression *right = parser->parse_expression(ast::ASSIGNMENT - 1);
 
         return new ast::BinaryExpression(token.origin, ast::ASSIGN, left, right);
     }
-
-    ast::Precedence get_type() override {
-        return ast::ASSIGNMENT;
-    }
 };
 
-class StructInitParselet : public InfixParselet {
-    ast::Expression *parse(Parser *parser, const Token &, ast::Expression *left) override {
+struct StructInitParselet {
+    static constexpr ast::Precedence precedence = ast::CALL;
+
+    static ast::Expression *parse(Parser *parser, const Token &, ast::Expression *left) {
         std::vector<ast::Expression *> args;
 
         while (!parser->is_peek(END) && !parser->is_peek(BRACKET_CLOSE)) {
@@ -120,17 +120,15 @@ class StructInitParselet : public InfixParselet {
         return new ast::StructInitExpression(origin, left, args);
     }
 
-    bool can_parse(ast::Expression *left) override {
+    static bool can_parse(ast::Expression *left) {
         return left->expression_type == ast::NAME_EXPR || left->expression_type == ast::PATH_EXPR;
     }
-
-    ast::Precedence get_type() override {
-        return ast::CALL;
-    }
 };
 
-class CallParselet : public InfixParselet {
-    ast::Expression *parse(Parser *parser, const Token &token, ast::Expression *left) override {
+struct CallParselet : AnyLeftParselet {
+    static constexpr ast::Precedence precedence = ast::CALL;
+
+    static ast::Expression *parse(Parser *parser, const Token &token, ast::Expression *left) {
         if (left->expression_type == ast::MACRO_NAME_EXPR ||
             (left->expression_type == ast::MEM_ACC_EXPR &&
                 ((ast::BinaryExpression *) left)->right->expression_type == ast::MACRO_NAME_EXPR))
@@ -150,27 +148,25 @@ class CallParselet : public InfixParselet {
         return new ast::CallExpression(origin, left, args);
     }
 
-    ast::Expression *parse_macro(Parser *parser, const Token &token, ast::Expression *left) {
+    static ast::Expression *parse_macro(Parser *parser, const Token &token, ast::Expression *left) {
         std::vector<ast::Expression *> args;
 
         while (!parser->is_peek(END) && !parser->is_peek(PAREN_CLOSE)) {
-            Lexer::State state = parser->lexer.checkpoint();
-            std::optional type = parser->type();
-
-            if ((!parser->is_peek(PAREN_CLOSE) && !parser->is_peek(COMMA)) ||
-                (type.has_value() && type.value().pointer_level == 0 && !type.value().is_primitive() &&
-                    type.value().get_user().get_parts().size() == 1)) {
-                // Either the argument isn't done or the argument was too simple to definitely be a type
-                parser->lexer.rollback(state);
-                type = {};
-            }
-
-            if (!type.has_value())
-                args.push_back(parser->parse_expression());
-            else
-                args.push_back(new ast::TypeExpression(type.value(),
-                                                       state.pos.as_zero_range() +
+            int length = parser->match_type();
+            TokenType after = parser->lexer.peek(length).id;
+            // A single name, global or not, is too simple to definitely be a type
+            bool lone_name = length <= 2 && parser->lexer.peek(length - 1).id == NAME;
+
+            // The argument also has to end right after the type
+            if (length > 0 && (after == PAREN_CLOSE || after == COMMA) && !lone_name) {
+                LexerPos start = parser->lexer.checkpoint().pos;
+                Type type = parser->type().value();
+                args.push_back(new ast::TypeExpression(type,
+                                                       start.as_zero_range() +
                                                        parser->lexer.checkpoint().pos.as_zero_range()));
+            } else {
+                args.push_back(parser->parse_expression());
+            }
 
             if (!parser->is_peek(COMMA))
                 break;
@@ -180,14 +176,10 @@ class CallParselet : public InfixParselet {
 
         return new ast::CallExpression(token.origin, left, args);
     }
-
-    ast::Precedence get_type() override {
-        return ast::CALL;
-    }
 };
 
-class ListParselet : public PrefixParselet {
-    ast::Expression *parse(Parser *parser, const Token &left) override {
+struct ListParselet {
+    static ast::Expression *parse(Parser *parser, const Token &left) {
         std::vector<ast::Expression *> elements;
         while (!parser->is_peek(BRACKET_CLOSE) && !parser->is_peek(END)) {
             elements.push_back(parser->parse_expression());
@@ -202,4 +194,65 @@ class ListParselet : public PrefixParselet {
     }
 };
 
+template <class P>
+constexpr PrefixParselet prefix_parselet() {
+    return {&P::parse};
+}
+
+template <class P>
+constexpr InfixParselet infix_parselet() {
+    return {&P::parse, &P::can_parse, P::precedence};
+}
+
+inline constexpr std::array<PrefixParselet, TOKEN_TYPE_COUNT> prefix_parslets = [] {
+    std::array<PrefixParselet, TOKEN_TYPE_COUNT> table {};
+
+    // Trivial expressions
+    table[NAME] = prefix_parselet<NameParselet>();
+    table[MACRO_NAME] = prefix_parselet<MacroNameParselet>();
+    table[INTEGER] = prefix_parselet<IntParselet>();
+    table[REAL] = prefix_parselet<RealParselet>();
+    table[STRING] = prefix_parselet<StringParselet>();
+    table[TRUE] = prefix_parselet<BoolParselet>();
+    table[FALSE] = prefix_parselet<BoolParselet>();
+
+    // Prefix expressions
+    table[MINUS] = prefix_parselet<NegParselet>();
+    table[AMPERSAND] = prefix_parselet<RefParselet>();
+    table[ASTERISK] = prefix_parselet<DerefParselet>();
+    table[NOT] = prefix_parselet<NotParselet>();
+    table[DOUBLE_COLON] = prefix_parselet<GlobalParselet>();
+    table[PAREN_OPEN] = prefix_parselet<GroupParselet>();
+    table[BRACKET_OPEN] = prefix_parselet<ListParselet>();
+
+    return table;
+}();
+
+inline constexpr std::array<InfixParselet, TOKEN_TYPE_COUNT> infix_parslets = [] {
+    std::array<InfixParselet, TOKEN_TYPE_COUNT> table {};
+
+    // Binary expressions
+    table[DOUBLE_COLON] = infix_parselet<PathParselet>();
+    table[PLUS] = infix_parselet<AddParselet>();
+    table[MINUS] = infix_parselet<SubParselet>();
+    table[ASTERISK] = infix_parselet<MulParselet>();
+    table[SLASH] = infix_parselet<DivParselet>();
+    table[DOUBLE_EQUAL] = infix_parselet<EqParselet>();
+    table[NOT_EQUAL] = infix_parselet<NeqParselet>();
+    table[SMALLER] = infix_parselet<SmParselet>();
+    table[GREATER] = infix_parselet<GrParselet>();
+    table[SMALLER_EQUAL] = infix_parselet<SeParselet>();
+    table[GREATER_EQUAL] = infix_parselet<GeParselet>();
+    table[PERIOD] = infix_parselet<MemberAccessParselet>();
+
+    // Call
+    table[PAREN_OPEN] = infix_parselet<CallParselet>();
+    table[BRACKET_OPEN] = infix_parselet<StructInitParselet>();
+
+    // Assign expressions
+    table[EQUAL] = infix_parselet<AssignParselet>();
+
+    return table;
+}();
+
 #endif //TARIK_SRC_SYNTACTIC_EXPRESSIONS_PARSLETS_H_
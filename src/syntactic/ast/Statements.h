@@ -27,12 +27,6 @@ public:
         : Statement(t, o),
           block(std::move(b)) {}
 
-    ~ScopeStatement() override {
-        for (auto *st : block) {
-            delete st;
-        }
-    }
-
     [[nodiscard]] std::string print() const override {
         std::string res = "{";
         for (auto *st : block) {
@@ -67,11 +61,6 @@ public:
         : ScopeStatement(IF_STMT, o + cond->origin, std::move(block)),
           condition(cond) {}
 
-    ~IfStatement() override {
-        delete condition;
-        delete else_statement;
-    }
-
     [[nodiscard]] std::string print() const override {
         std::string then_string = ScopeStatement::print();
         std::string if_string = "if " + condition->print() + " " + then_string;
@@ -90,10 +79,6 @@ public:
         : Statement(RETURN_STMT, val ? o + val->origin : o),
           value(val) {}
 
-    ~ReturnStatement() override {
-        delete value;
-    }
-
     [[nodiscard]] std::string print() const override {
         if (value)
             return "return " + value->print() + ";";
@@ -111,10 +96,6 @@ public:
         : ScopeStatement(WHILE_STMT, o + cond->origin, std::move(block)),
           condition(cond) {}
 
-    ~WhileStatement() override {
-        delete condition;
-    }
-
     [[nodiscard]] std::string print() const override {
         std::string then_string = ScopeStatement::print();
         return "while " + condition->print() + " " + then_string;
@@ -152,7 +133,7 @@ public:
           name(std::move(n)) {}
 
     [[nodiscard]] std::string print() const override {
-        return type.str() + " " + name.raw + ";";
+        return type.str() + " " + std::string(name.raw) + ";";
     }
 };
 
@@ -175,16 +156,10 @@ public:
           arguments(std::move(args)),
           member_of(std::move(mo)) {}
 
-    ~FuncStatement() override {
-        for (auto *arg : arguments) {
-            delete arg;
-        }
-    }
-
     [[nodiscard]] std::string head() const {
-        std::string res = "fn " + name.raw + "(";
+        std::string res = "fn " + std::string(name.raw) + "(";
         for (auto *arg : arguments) {
-            res += arg->type.str() + " " + arg->name.raw + ", ";
+            res += arg->type.str() + " " + std::string(arg->name.raw) + ", ";
         }
         if (res.back() != '(')
             res = res.substr(0, res.size() - 2);
@@ -216,12 +191,6 @@ public:
           name(std::move(n)),
           members(std::move(m)) {}
 
-    ~StructStatement() override {
-        for (const auto *m : members) {
-            delete m;
-        }
-    }
-
     bool has_member(const std::string &n) {
         for (auto *mem : members) {
             if (mem->name.raw == n)
@@ -231,7 +200,7 @@ public:
     }
 
     Type get_type(const Path &path) {
-        return Type(path.create_member(this->name.raw), 0);
+        return Type(path.create_member(std::string(this->name.raw)), 0);
     }
 
     Type get_member_type(const std::string &n) {
@@ -251,7 +220,7 @@ public:
     }
 
     [[nodiscard]] std::string print() const override {
-        std::string res = "struct " + name.raw + " {";
+        std::string res = "struct " + std::string(name.raw) + " {";
         for (auto *mem : members) {
             res += "\n    " + mem->print();
         }
@@ -0,0 +1,76 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "Benchmark.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <print>
+
+#include "Arena.h"
+#include "error/Bucket.h"
+#include "lexical/Lexer.h"
+#include "lexical/Scan.h"
+#include "lexical/Source.h"
+#include "syntactic/Parser.h"
+
+using Clock = std::chrono::steady_clock;
+
+void benchmark_lexer(const std::filesystem::path &file) {
+    const SourceFile *source = SourceManager::load(file);
+    if (!source) {
+        std::cerr << "Couldn't open " << file << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    size_t tokens = 0, iterations = 0;
+    Clock::time_point start = Clock::now();
+    std::chrono::duration<double> elapsed {};
+
+    do {
+        Lexer lexer(source);
+        while (lexer.consume().id != END)
+            tokens++;
+        iterations++;
+        elapsed = Clock::now() - start;
+    } while (elapsed.count() < 1.0);
+
+    std::println("lexed {} tokens in {} iterations over {:.3f}s", tokens, iterations, elapsed.count());
+    std::println("{:.0f} tokens/s, {:.1f} MB/s ({} scanner)",
+                 (double) tokens / elapsed.count(),
+                 (double) (source->text().size() * iterations) / elapsed.count() / 1e6,
+                 scan_implementation());
+}
+
+void benchmark_parser(const std::filesystem::path &file) {
+    const SourceFile *source = SourceManager::load(file);
+    if (!source) {
+        std::cerr << "Couldn't open " << file << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    size_t tokens = Lexer(source).get_tokens().size(), statements = 0, iterations = 0;
+    Clock::time_point start = Clock::now();
+    std::chrono::duration<double> elapsed {};
+
+    do {
+        Arena arena;
+        Arena::Guard guard(arena);
+        Bucket bucket;
+        Parser parser(source, &bucket);
+        while (parser.parse_statement())
+            statements++;
+        iterations++;
+        elapsed = Clock::now() - start;
+    } while (elapsed.count() < 1.0);
+
+    std::println("parsed {} statements in {} iterations over {:.3f}s", statements, iterations, elapsed.count());
+    std::println("{:.0f} statements/s, {:.0f} tokens/s, {:.1f} MB/s",
+                 (double) statements / elapsed.count(),
+                 (double) (tokens * iterations) / elapsed.count(),
+                 (double) (source->text().size() * iterations) / elapsed.count() / 1e6);
+}
@@ -0,0 +1,17 @@
+// tarik (c) Nikolas Wipper 2025
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef TARIK_SRC_TESTING_BENCHMARK_H_
+#define TARIK_SRC_TESTING_BENCHMARK_H_
+
+#include <filesystem>
+
+// Lex file repeatedly for about a second and print the throughput
+void benchmark_lexer(const std::filesystem::path &file);
+// Parse file's statements repeatedly for about a second and print the throughput, without following imports
+void benchmark_parser(const std::filesystem::path &file);
+
+#endif //TARIK_SRC_TESTING_BENCHMARK_H_
@@ -4,21 +4,22 @@
 #include <fstream>
 #include <set>
 
+#include "Arena.h"
 #include "cli/Arguments.h"
+#include "Benchmark.h"
 #include "Testing.h"
 #include "Version.h"
 #include "codegen/LLVM.h"
+#include "lexical/Source.h"
 #include "lifetime/Analyser.h"
 #include "syntactic/Parser.h"
 
 void compile_test_file(Bucket &bucket, const std::string &file_name) {
+    Arena arena;
+    Arena::Guard arena_guard(arena);
     Parser p(file_name, &bucket);
 
-    std::vector<ast::Statement *> statements;
-    do {
-        statements.push_back(p.parse_statement());
-    } while (statements.back());
-    statements.pop_back();
+    std::vector<ast::Statement *> statements = p.parse();
 
     std::vector<aast::Statement *> analysed_statements;
     if (bucket.get_error_count() != 0)
@@ -90,6 +91,8 @@ void read_test_file(Tester &tester, const std::string &file_name) {
         }
     }
 
+    // Every test file is a compilation of its own, their sources are dropped once its diagnostics are checked
+    SourceManager::Scope sources;
     Bucket bucket;
 
     compile_test_file(bucket, file_name);
@@ -103,19 +106,19 @@ void read_test_file(Tester &tester, const std::string &file_name) {
 
             for (auto &error : errors) {
                 if (error.kind == ErrorKind::ERROR) {
-                    if (tester.Assert(expected_errors.contains(error.origin.l),
+                    if (tester.Assert(expected_errors.contains(error.origin.line()),
                                       std::format("Extra error in {}:{} : {}",
-                                                  error.origin.l,
-                                                  error.origin.p,
+                                                  error.origin.line(),
+                                                  error.origin.column(),
                                                   error.message)))
-                        found_errors.insert(error.origin.l);
+                        found_errors.insert(error.origin.line());
                 } else if (error.kind == ErrorKind::WARNING) {
-                    if (tester.Assert(expected_warnings.contains(error.origin.l),
+                    if (tester.Assert(expected_warnings.contains(error.origin.line()),
                                       std::format("Extra warning in {}:{} : {}",
-                                                  error.origin.l,
-                                                  error.origin.p,
+                                                  error.origin.line(),
+                                                  error.origin.column(),
                                                   error.message)))
-                        found_warnings.insert(error.origin.l);
+                        found_warnings.insert(error.origin.line());
                 }
             }
 
@@ -135,11 +138,25 @@ void read_test_file(Tester &tester, const std::string &file_name) {
 int main(int argc, const char *argv[]) {
     ArgumentParser parser(argc, argv, "tarik-testing");
 
+    Option *bench_lexer = parser.add_option("bench-lexer",
+                                            "Benchmarks",
+                                            "Measure lexer throughput on a file instead of running the tests",
+                                            "file");
+    Option *bench_parser = parser.add_option("bench-parser",
+                                             "Benchmarks",
+                                             "Measure parser throughput on a file instead of running the tests",
+                                             "file");
     Option *version = parser.add_option("version", "Miscellaneous", "Display the compiler version");
 
     if (argc > 1) {
         for (const auto &option : parser) {
-            if (option == version) {
+            if (option == bench_lexer) {
+                benchmark_lexer(option.argument);
+                return 0;
+            } else if (option == bench_parser) {
+                benchmark_parser(option.argument);
+                return 0;
+            } else if (option == version) {
                 std::cout << version_id << " tarik compiler tester version " << version_string << "\n";
                 return 0;
             }
@@ -6,11 +6,22 @@
 
 #include "Testing.h"
 
+#include "Arena.h"
+#include "cfg/Lowering.h"
+#include "semantic/Analyser.h"
+#include "semantic/Folding.h"
+#include "semantic/Variables.h"
 #include "syntactic/Parser.h"
 #include "syntactic/Types.h"
 #include "syntactic/ast/Expression.h"
+#include "tlib/ModuleCache.h"
+#include "utf/Utf.h"
 
+#include <fstream>
 #include <sstream>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
 
 void *operator new(size_t size) {
     void *p = malloc(size);
@@ -58,8 +69,8 @@ bool Tester::Assert(bool condition, std::string msg) {
     return condition;
 }
 
-void Tester::AssertTok(Lexer lexer, TokenType type, const std::string &tok) {
-    std::string s = lexer.peek().raw;
+void Tester::AssertTok(Lexer &lexer, TokenType type, const std::string &tok) {
+    std::string s = std::string(lexer.peek().raw);
     std::string &sr = s;
     Assert(lexer.peek().raw == tok, std::format("Failed for token '{}': expected '{}'.", sr, tok));
     lexer.consume();
@@ -79,10 +90,38 @@ void selftest(Tester &tester) {
     using ss = std::stringstream;
     int overhead = allocs;
     Bucket error_bucket;
+    Arena arena;
+    Arena::Guard arena_guard(arena);
 
     tester.StartSegment("utility");
     {
         tester.AssertEq(Type(Path({"ÜberÄnderung"}, LexerRange())).func_name(), "über_änderung");
+        tester.AssertEq(Type(Path({"HashMap"}, LexerRange())).func_name(), "hash_map");
+        tester.AssertTrue(is_ascii("plain ascii text, longer than one vector"));
+        tester.AssertTrue(!is_ascii("plain ascii text, then Ü"));
+        tester.AssertEq(find_invalid_utf8("Überänderung, 日本語, 🦀"), std::string_view::npos);
+        tester.AssertEq(find_invalid_utf8("ascii text that fills a vector \xC0\xAF"), 31);
+        tester.AssertEq(find_invalid_utf8("\xED\xA0\x80"), 0);
+        tester.AssertEq(find_invalid_utf8("ab\xE2\x82"), 2);
+        // Longer than one AVX2 block, with sequences and errors across block boundaries
+        std::string multibyte = "Überänderung, 日本語, 🦀, Überänderung, 日本語, 🦀, Überänderung";
+        tester.AssertEq(find_invalid_utf8(multibyte), std::string_view::npos);
+        tester.AssertEq(find_invalid_utf8(std::string(30, 'a') + "\xE2\x82\xAC\xE2\x82" + std::string(40, 'b')), 33);
+        tester.AssertEq(find_invalid_utf8(std::string(31, 'a') + "\xF0\x9F\x98" + std::string(40, 'b')), 31);
+        tester.AssertEq(find_invalid_utf8(multibyte + "\xED\xBF\xBF"), multibyte.size());
+        tester.AssertEq(find_invalid_utf8(std::string(63, 'a') + "\xC3"), 63);
+        tester.AssertTrue(Symbol("peter") == Symbol(std::string("pet") + "er"));
+        tester.AssertTrue(Symbol("peter") != Symbol("petra"));
+        tester.AssertEq(Symbol("peter").str(), "peter");
+        tester.AssertTrue(Symbol("").empty());
+        tester.AssertTrue(Path({"a", "b"}, LexerRange()) == Path({"a"}, LexerRange()).create_member("b"));
+        tester.AssertTrue(Path({"b"}, LexerRange()).with_prefix(Path({"a"}, LexerRange())) ==
+                          Path({"a", "b"}, LexerRange()));
+        tester.AssertTrue(Path({"a", "b"}, LexerRange()).get_parent() != Path({"b"}, LexerRange()));
+        tester.AssertEq(Path({"", "a", "b"}, LexerRange()).str(), "a::b");
+        tester.AssertTrue(Path({"a", "*", "b"}, LexerRange()).contains_pointer());
+        tester.AssertTrue(TypeId(Type(I32)).get_pointer_to() == TypeId(Type(I32, 1)));
+        tester.AssertTrue(TypeId(Type(I32, 2)).get_deref().get_deref() == TypeId(Type(I32)));
     }
 
     tester.EndSegment();
@@ -116,6 +155,18 @@ void selftest(Tester &tester) {
         tester.AssertTok(lexer, NAME, "back");
     }
 
+    {
+        const SourceFile *file = SourceManager::add("", "peter \"plain\"");
+        Lexer lexer(file);
+
+        // Names point into the symbol table, strings without escape sequences into the source
+        Token name = lexer.consume();
+        tester.AssertTrue(name.raw.data() == name.symbol.str().data());
+        tester.AssertTrue(lexer.consume().raw.data() == file->text().data() + 7);
+        // Lookahead past the end of the file keeps returning END
+        tester.AssertTrue(lexer.peek(5).id == END);
+    }
+
     tester.EndSegment();
     tester.StartSegment("expression parsing");
 
@@ -125,45 +176,38 @@ void selftest(Tester &tester) {
             ast::Expression *e = Parser(&(c = ss("3 + 4 * 5")), &error_bucket).parse_expression();
             tester.AssertNoError(error_bucket);
             tester.AssertEq(e->print(), "(3+(4*5))");
-            delete e;
         }
         {
             ast::Expression *e = Parser(&(c = ss("-3 + -4 * 5")), &error_bucket).parse_expression();
             tester.AssertNoError(error_bucket);
             tester.AssertEq(e->print(), "(-3+(-4*5))");
-            delete e;
         }
         {
             Parser p(&(c = ss("-name + 4 * -5")), &error_bucket);
             tester.AssertNoError(error_bucket);
             ast::Expression *e = p.parse_expression();
             tester.AssertEq(e->print(), "(-name+(4*-5))");
-            delete e;
         }
         {
             ast::Expression *e = Parser(&(c = ss("(3 + 4) * 5")), &error_bucket).parse_expression();
             tester.AssertNoError(error_bucket);
             tester.AssertEq(e->print(), "((3+4)*5)");
-            delete e;
         }
         {
             Parser tmp = Parser(&(c = ss("3 + 4 * 5; 6 + 7 * 8")), &error_bucket);
             ast::Expression *e = tmp.parse_expression();
             tester.AssertNoError(error_bucket);
             tester.AssertEq(e->print(), "(3+(4*5))");
-            delete e;
             tmp.expect(SEMICOLON);
             e = tmp.parse_expression();
             tester.AssertNoError(error_bucket);
             tester.AssertEq(e->print(), "(6+(7*8))");
-            delete e;
         }
         {
             Parser p = Parser(&(c = ss("func(1, 2, 3, 4)")), &error_bucket);
             ast::Expression *e = p.parse_expression();
             tester.AssertNoError(error_bucket);
             tester.AssertEq(e->print(), "func(1, 2, 3, 4)");
-            delete e;
         }
     }
 
@@ -179,7 +223,6 @@ void selftest(Tester &tester) {
         tester.AssertNoError(error_bucket);
         tester.AssertEq(ifStatement->statement_type, ast::IF_STMT);
         tester.AssertEq(ifStatement->condition->print(), "(4+4)");
-        delete ifStatement;
 
         // Functions
         {
@@ -199,8 +242,6 @@ void selftest(Tester &tester) {
             tester.AssertNoError(error_bucket);
             tester.AssertEq(call->callee->print(), "test_func");
 
-            delete call;
-            delete func;
         }
 
         // Variables and assignments
@@ -217,9 +258,6 @@ void selftest(Tester &tester) {
         tester.AssertNoError(error_bucket);
         tester.AssertEq(first->expression_type, ast::ASSIGN_EXPR);
         tester.AssertEq(second->expression_type, ast::ASSIGN_EXPR);
-        delete var;
-        delete first;
-        delete second;
 
         auto *ptr = (ast::VariableStatement *) p.parse_statement();
         tester.AssertEq(ptr->statement_type, ast::VARIABLE_STMT);
@@ -227,7 +265,6 @@ void selftest(Tester &tester) {
         tester.AssertTrue(ptr->type.is_primitive());
         tester.AssertEq(ptr->type.pointer_level, 1);
         tester.AssertEq(ptr->type, Type(U32, 1));
-        delete ptr;
     }
 
     tester.EndSegment();
@@ -273,14 +310,358 @@ void selftest(Tester &tester) {
         tester.AssertEq(ret_stmt->value->statement_type, ast::EXPR_STMT);
         tester.AssertEq(((ast::Expression *) ret_stmt->value)->expression_type, ast::NAME_EXPR);
 
-        delete s;
+    }
+
+    tester.EndSegment();
+    tester.StartSegment("constant folding");
+
+    {
+        auto literal = [](long long n) { return new aast::IntExpression(LexerRange(), n); };
+
+        // 1 + 2 * 3 / 4, untyped literals are folded exactly
+        auto *product = new aast::BinaryExpression(LexerRange(), Type(U0), aast::MUL, literal(2), literal(3));
+        auto *quotient = new aast::BinaryExpression(LexerRange(), Type(U0), aast::DIV, product, literal(4));
+        aast::Expression *sum = fold_expression(
+            new aast::BinaryExpression(LexerRange(), Type(U0), aast::ADD, literal(1), quotient));
+
+        tester.AssertEq(sum->expression_type, aast::INT_EXPR);
+        tester.AssertEq(((aast::IntExpression *) sum)->n, 2);
+        tester.AssertTrue(sum->type == Type(U0));
+
+        // as!(200, u8) + as!(100, u8) wraps around
+        auto *wrapped = fold_expression(new aast::BinaryExpression(
+            LexerRange(),
+            Type(U8),
+            aast::ADD,
+            new aast::CastExpression(LexerRange(), Type(U8), literal(200)),
+            new aast::CastExpression(LexerRange(), Type(U8), literal(100))));
+
+        tester.AssertEq(wrapped->expression_type, aast::INT_EXPR);
+        tester.AssertEq(((aast::IntExpression *) wrapped)->n, 44);
+        tester.AssertTrue(wrapped->type == Type(U8));
+
+        auto *division = fold_expression(
+            new aast::BinaryExpression(LexerRange(), Type(U0), aast::DIV, literal(1), literal(0)));
+        tester.AssertEq(division->expression_type, aast::DOT_EXPR);
+
+        auto *comparison = fold_expression(
+            new aast::BinaryExpression(LexerRange(), Type(BOOL), aast::SM, literal(3), literal(5)));
+        tester.AssertEq(comparison->expression_type, aast::BOOL_EXPR);
+        tester.AssertTrue(((aast::BoolExpression *) comparison)->n);
+
+        // if false {} else { 1; } while false { 2; }
+        auto *if_ = new aast::IfStatement(LexerRange(), new aast::BoolExpression(LexerRange(), false), {});
+        if_->else_statement = new aast::ElseStatement(LexerRange(), {literal(1)});
+        std::vector<aast::Statement *> block = {
+            if_,
+            new aast::WhileStatement(LexerRange(), new aast::BoolExpression(LexerRange(), false), {literal(2)})
+        };
+        fold_statements(block);
+
+        tester.AssertEq(block.size(), 1);
+        tester.AssertEq(((aast::IntExpression *) block[0])->n, 1);
+    }
+
+    tester.EndSegment();
+    tester.StartSegment("control flow graph");
+
+    {
+        auto literal = [](long long n) { return new aast::IntExpression(LexerRange(), n); };
+        auto *a = new aast::VariableStatement(LexerRange(), Type(I32), Token::name("a", LexerRange()));
+        auto var = [a] { return new aast::VariableExpression(LexerRange(), a); };
+
+        // fn f(i32 a) i32 { while a < 3 { a = a + 1; if a == 2 { break; } } return a; }
+        auto *increment = new aast::BinaryExpression(
+            LexerRange(),
+            Type(I32),
+            aast::ASSIGN,
+            var(),
+            new aast::BinaryExpression(LexerRange(), Type(I32), aast::ADD, var(), literal(1)));
+        auto *if_ = new aast::IfStatement(LexerRange(),
+                                          new aast::BinaryExpression(LexerRange(), Type(BOOL), aast::EQ, var(),
+                                                                     literal(2)),
+                                          {new aast::BreakStatement(LexerRange())});
+        auto *while_ = new aast::WhileStatement(LexerRange(),
+                                                new aast::BinaryExpression(LexerRange(), Type(BOOL), aast::SM, var(),
+                                                                           literal(3)),
+                                                {increment, if_});
+        auto *func = new aast::FuncStatement(LexerRange(),
+                                             Path({"f"}, LexerRange()),
+                                             Type(I32),
+                                             {a},
+                                             {while_, new aast::ReturnStatement(LexerRange(), var())},
+                                             false);
+
+        std::vector<cfg::Function> functions = cfg::lower({func});
+        tester.AssertEq(functions.size(), 1);
+
+        // Entry, loop header, body, exit, then branch of the if, and the block after it
+        const cfg::Function &f = functions[0];
+        tester.AssertEq(f.blocks.size(), 6);
+        tester.AssertTrue(f.successors(0) == std::vector<cfg::BlockId> {1});
+        tester.AssertTrue(f.successors(1) == std::vector<cfg::BlockId> {2, 3});
+        tester.AssertTrue(f.blocks[1].predecessors == std::vector<cfg::BlockId> {0, 5});
+        // Leaving the loop normally, and through the break
+        tester.AssertTrue(f.blocks[3].predecessors == std::vector<cfg::BlockId> {1, 4});
+        tester.AssertEq(f.blocks[3].terminator.kind, cfg::RETURN);
+        tester.AssertEq(f.instructions[f.blocks[3].instructions.back()].opcode, cfg::KILL);
+
+        // Instructions are numbered in block order
+        cfg::Value next = 0;
+        bool ordered = true;
+        for (const auto &block : f.blocks) {
+            for (cfg::Value value : block.instructions)
+                ordered = ordered && value == next++;
+        }
+        tester.AssertTrue(ordered);
+        tester.AssertEq(next, f.instructions.size());
+
+        // fn g() { return; 1; }, code after the return is removed
+        auto *g = new aast::FuncStatement(LexerRange(),
+                                          Path({"g"}, LexerRange()),
+                                          Type(VOID),
+                                          {},
+                                          {new aast::ReturnStatement(LexerRange(), nullptr), literal(1)},
+                                          false);
+        functions = cfg::lower({g});
+        tester.AssertEq(functions[0].blocks.size(), 1);
+        tester.AssertEq(functions[0].instructions.size(), 0);
     }
 
     tester.EndSegment();
     tester.StartSegment("memory management");
 
     {
+        // A node whose constructor throws is destroyed on the spot, the arena mustn't destroy it a second time
+        struct ThrowingStatement : ast::Statement {
+            std::string text = std::string(64, 'x');
+
+            ThrowingStatement() { throw std::runtime_error("constructor failed"); }
+
+            [[nodiscard]] std::string print() const override { return text; }
+        };
+        bool thrown = false;
+        try {
+            new ThrowingStatement();
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        tester.AssertTrue(thrown);
+
+        arena.release();
         tester.AssertEq(allocs - overhead, 0);
     }
     tester.EndSegment();
+    // These compile whole files, which interns their symbols and paths for good, so they come after the allocation check
+    tester.StartSegment("imports");
+
+    {
+        SourceManager::Scope sources;
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "tarik-selftest-imports";
+        std::filesystem::create_directories(directory);
+        auto write = [&](const std::string &name, const std::string &code) {
+            std::ofstream(directory / name) << code;
+        };
+        // b and c both import d, which only gets attached to the first of them. Every import has a syntax error.
+        write("main.tk", "import b;\nimport c;\nfn main() u8 { return 0; }\n");
+        write("b.tk", "import d;\nstruct unended_b {\n");
+        write("c.tk", "import d;\nstruct unended_c {\n");
+        write("d.tk", "struct unended_d {\n");
+
+        std::vector<std::vector<std::string>> runs;
+        for (int run = 0; run < 4; run++) {
+            Bucket bucket;
+            Parser p(directory / "main.tk", &bucket);
+            std::vector<ast::Statement *> statements = p.parse();
+
+            tester.AssertEq(statements.size(), 3);
+            auto *b = (ast::ImportStatement *) statements[0];
+            auto *c = (ast::ImportStatement *) statements[1];
+            tester.AssertEq(b->statement_type, ast::IMPORT_STMT);
+            tester.AssertEq(b->block.size(), 2);
+            tester.AssertEq(b->block[0]->statement_type, ast::IMPORT_STMT);
+            tester.AssertEq(((ast::ImportStatement *) b->block[0])->block.size(), 1);
+            tester.AssertEq(((ast::ImportStatement *) c->block[0])->block.size(), 0);
+
+            // Diagnostics of imported files are merged into the main bucket, in the order the files were loaded in
+            std::vector<std::string> files;
+            for (const Error &error : bucket.get_errors()) {
+                std::string name = std::filesystem::path(SourceManager::get(error.origin.file).get_name()).filename();
+                if (files.empty() || files.back() != name)
+                    files.push_back(name);
+            }
+            tester.AssertEq(files.size(), 3);
+            if (files.size() == 3) {
+                tester.AssertEq(files[0], "b.tk");
+                tester.AssertEq(files[1], "c.tk");
+                tester.AssertEq(files[2], "d.tk");
+            }
+
+            std::vector<std::string> messages;
+            for (const Error &error : bucket.get_errors())
+                messages.push_back(std::format("{}:{}: {}", error.origin.line(), error.origin.column(), error.message));
+            runs.push_back(messages);
+        }
+        for (const auto &messages : runs)
+            tester.AssertTrue(messages == runs[0]);
+
+        std::filesystem::remove_all(directory);
+    }
+    tester.EndSegment();
+    tester.StartSegment("module cache");
+
+    {
+        SourceManager::Scope sources;
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "tarik-selftest-cache";
+        std::filesystem::remove_all(directory);
+        ModuleCache cache(directory);
+
+        const SourceFile *file = SourceManager::add(directory / "cached.tk",
+                                                    "struct pair {\n    u8 first;\n    u8 second;\n}\n"
+                                                    "fn pair.sum(this) u8 {\n"
+                                                    "    return this.first + this.second;\n}\n");
+        Bucket bucket;
+        std::vector<ast::Statement *> stored = Parser(file, &bucket).parse();
+        tester.AssertNoError(bucket);
+        cache.store(*file, {}, stored);
+
+        std::vector<ast::Statement *> statements;
+        std::vector<ast::ImportStatement *> imports;
+        std::optional<ModuleCache::Entry> entry = cache.find(*file);
+        tester.AssertTrue(entry.has_value());
+        tester.AssertTrue(entry.has_value() && ModuleCache::read(entry.value(), statements, imports));
+        tester.AssertEq(statements.size(), stored.size());
+        tester.AssertTrue(imports.empty());
+        for (std::size_t i = 0; i < statements.size() && i < stored.size(); i++) {
+            tester.AssertEq(statements[i]->statement_type, stored[i]->statement_type);
+            tester.AssertTrue(statements[i]->origin == stored[i]->origin);
+        }
+        if (statements.size() == 2) {
+            auto *function = (ast::FuncStatement *) statements[1];
+            tester.AssertEq(function->name.raw, "sum");
+            tester.AssertEq(function->member_of.value(), Type(Path({"pair"}, LexerRange())));
+            tester.AssertEq(function->block.size(), 1);
+        }
+
+        std::filesystem::path entry_file = std::filesystem::directory_iterator(directory)->path();
+        std::uintmax_t size = std::filesystem::file_size(entry_file);
+
+        // A size that claims more elements than the entry could possibly hold
+        {
+            std::fstream damaged(entry_file, std::ios::binary | std::ios::in | std::ios::out);
+            // Magic, format version, file size and import count come before the number of statements
+            damaged.seekp(4 + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t));
+            uint32_t count = 0xffffffff;
+            damaged.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        }
+        entry = cache.find(*file);
+        tester.AssertTrue(entry.has_value());
+        tester.AssertTrue(entry.has_value() && !ModuleCache::read(entry.value(), statements, imports));
+
+        // Entries cut off anywhere are rejected by either find() or read()
+        cache.store(*file, {}, stored);
+        for (std::uintmax_t cut : {size - 1, size / 2, (std::uintmax_t) 10}) {
+            std::filesystem::resize_file(entry_file, cut);
+            entry = cache.find(*file);
+            tester.AssertTrue(!entry.has_value() || !ModuleCache::read(entry.value(), statements, imports));
+        }
+
+        std::filesystem::remove_all(directory);
+    }
+    tester.EndSegment();
+    tester.StartSegment("variable states");
+
+    {
+        auto field = [](const char *name) {
+            return new aast::VariableStatement(LexerRange(), Type(I32), Token::name(name, LexerRange()));
+        };
+        Path outer_path = Path({"outer"}, LexerRange());
+        auto *outer = new aast::StructStatement(LexerRange(), outer_path, {field("first"), field("count")});
+        auto *o = new aast::VariableStatement(LexerRange(), Type(outer_path), Token::name("o", LexerRange()));
+        LexerRange initialised = {{0, 1}, 1}, moved = {{0, 2}, 1}, assigned = {{0, 3}, 1};
+
+        VariableStates states;
+
+        // Moving a field inside an if, which splits the struct in there
+        SemanticVariable *var = states.add(o);
+        states.make_definitely_defined(var, initialised);
+        states.push_scope();
+        states.make_definitely_moved(states.get_field(var, outer, "first"), moved);
+        states.pop_scope(false);
+
+        SemanticVariable *first = states.get_field(var, outer, "first");
+        tester.AssertTrue(states.is_maybe_moved(first) && !states.is_definitely_moved(first));
+        tester.AssertTrue(states.is_maybe_moved(var) && !states.is_definitely_moved(var));
+        tester.AssertTrue(states.get_moved_pos(first) == moved);
+        tester.AssertTrue(states.get_moved_pos(var) == moved);
+        tester.AssertTrue(states.is_definitely_defined(states.get_field(var, outer, "count")));
+
+        // Assigning the whole struct inside an if, after one of its fields was moved
+        states.clear();
+        var = states.add(o);
+        states.make_definitely_defined(var, initialised);
+        first = states.get_field(var, outer, "first");
+        states.make_definitely_moved(first, moved);
+        states.push_scope();
+        states.make_definitely_defined(var, assigned);
+        tester.AssertTrue(states.is_definitely_defined(var));
+        states.pop_scope(false);
+
+        tester.AssertTrue(states.is_maybe_moved(first) && !states.is_definitely_moved(first));
+        tester.AssertTrue(states.is_maybe_defined(first) && !states.is_definitely_defined(first));
+        tester.AssertTrue(states.get_moved_pos(var) == moved);
+        tester.AssertTrue(states.get_defined_pos(first) == assigned);
+    }
+    tester.EndSegment();
+    tester.StartSegment("semantic analysis");
+
+    {
+        SourceManager::Scope sources;
+        // More functions than verify_functions makes batches, with errors spread over all of them and a redefinition,
+        // which is reported by the declaration pass, in between
+        std::size_t function_count = std::max(std::thread::hardware_concurrency(), 1u) * 8 + 5;
+        std::string source;
+        std::vector<int> expected_lines;
+        int line = 1;
+        for (std::size_t i = 0; i < function_count; i++) {
+            if (i == function_count / 2) {
+                expected_lines.push_back(line);
+                source += "fn f0() u8 {\n    return 0;\n}\n";
+                line += 3;
+            }
+            if (i % 7 == 3) {
+                expected_lines.push_back(line + 1);
+                source += std::format("fn f{}() u8 {{\n    return undefined;\n}}\n", i);
+            } else {
+                source += std::format("fn f{}() u8 {{\n    return {};\n}}\n", i, i % 100);
+            }
+            line += 3;
+        }
+
+        const SourceFile *file = SourceManager::add("functions.tk", source);
+        Bucket bucket;
+        std::vector<ast::Statement *> statements = Parser(file, &bucket).parse();
+        tester.AssertNoError(bucket);
+
+        Analyser analyser(&bucket, {});
+        analyser.analyse(statements);
+        std::vector<aast::Statement *> analysed = analyser.finish();
+
+        std::vector<int> lines;
+        for (const Error &error : bucket.get_errors()) {
+            if (error.kind == ErrorKind::ERROR && (lines.empty() || lines.back() != error.origin.line()))
+                lines.push_back(error.origin.line());
+        }
+        tester.AssertTrue(lines == expected_lines);
+
+        // Functions come out in source order, no matter which batch verified them
+        std::vector<uint32_t> offsets;
+        for (auto *statement : analysed) {
+            if (statement->statement_type == aast::FUNC_STMT)
+                offsets.push_back(statement->origin.offset);
+        }
+        tester.AssertTrue(offsets.size() >= function_count - (expected_lines.size() - 1));
+        tester.AssertTrue(std::ranges::is_sorted(offsets));
+    }
+    tester.EndSegment();
 }
@@ -31,7 +31,7 @@ public:
     template <class T, class U>
     void AssertEq(T t, U u);
 
-    void AssertTok(Lexer lexer, TokenType type, const std::string &tok);
+    void AssertTok(Lexer &lexer, TokenType type, const std::string &tok);
     void AssertTrue(bool condition);
     void AssertNoError(Bucket &bucket);
 };
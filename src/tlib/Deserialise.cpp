@@ -2,6 +2,8 @@
 
 #include "Deserialise.h"
 
+#include "lexical/Source.h"
+
 #include "syntactic/ast/Statements.h"
 
 void deserialise(std::istream &is, size_t &size) {
@@ -22,11 +24,10 @@ void deserialise(std::istream &is, std::string &str) {
 void deserialise(std::istream &is, LexerRange &range) {
     std::string filename;
     deserialise(is, filename);
-    size_t l, p, length;
-    deserialise(is, l);
-    deserialise(is, p);
+    size_t offset, length;
+    deserialise(is, offset);
     deserialise(is, length);
-    range = LexerRange {{(int) l, (int) p, filename}, (int) length};
+    range = LexerRange {{SourceManager::reference(filename), (uint32_t) offset}, (uint32_t) length};
 }
 
 void deserialise(std::istream &is, Path &path) {
@@ -52,8 +53,11 @@ void deserialise(std::istream &is, Type &type) {
 }
 
 void deserialise(std::istream &is, Token &token) {
-    deserialise(is, token.origin);
-    deserialise(is, token.raw);
+    LexerRange origin;
+    std::string raw;
+    deserialise(is, origin);
+    deserialise(is, raw);
+    token = Token::symbolic(token.id, Symbol(raw), origin);
 }
 
 void deserialise(std::istream &is, aast::VariableStatement *&var) {
@@ -0,0 +1,567 @@
+// tarik (c) Nikolas Wipper 2025
+
+#include "ModuleCache.h"
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+#include "Version.h"
+#include "syntactic/ast/Expression.h"
+
+// Bump this whenever the layout below or the syntax tree changes
+static constexpr uint32_t FORMAT_VERSION = 1;
+static constexpr char MAGIC[4] = {'T', 'K', 'M', 'C'};
+
+namespace
+{
+uint64_t fnv1a(std::string_view data, uint64_t hash = 0xcbf29ce484222325) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+class ModuleWriter {
+    std::ostream &os;
+
+public:
+    explicit ModuleWriter(std::ostream &os)
+        : os(os) {}
+
+    template <class T>
+    void write(T value) {
+        static_assert(std::is_integral_v<T> || std::is_floating_point_v<T> || std::is_enum_v<T>);
+        os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void write(std::string_view string) {
+        write((uint32_t) string.size());
+        os.write(string.data(), (std::streamsize) string.size());
+    }
+
+    // Ranges always point into the cached file itself, so only the offset is stored
+    void write(const LexerRange &range) {
+        write(range.offset);
+        write(range.length);
+    }
+
+    void write(const Token &token) {
+        write((uint8_t) token.id);
+        write(token.raw);
+        write(token.origin);
+    }
+
+    void write(const Path &path) {
+        write((uint8_t) path.is_global());
+        std::vector<std::string> parts = path.get_parts();
+        write((uint32_t) parts.size());
+        for (const std::string &part : parts)
+            write(std::string_view(part));
+        write(path.origin);
+    }
+
+    void write(const Type &type) {
+        write((int32_t) type.pointer_level);
+        write((uint8_t) type.is_primitive());
+        if (type.is_primitive())
+            write((uint8_t) type.get_primitive());
+        else
+            write(type.get_user());
+    }
+
+    template <class T>
+    void write_all(const std::vector<T *> &nodes) {
+        write((uint32_t) nodes.size());
+        for (auto *node : nodes)
+            write_node(node);
+    }
+
+    void write_node(ast::Statement *statement);
+    void write_expression(ast::Expression *expression);
+};
+
+// Smallest encoding of a string, a statement and a token; used to reject sizes that can't fit in what's left
+constexpr std::size_t MIN_STRING_SIZE = sizeof(uint32_t);
+constexpr std::size_t MIN_NODE_SIZE = sizeof(uint8_t) + 2 * sizeof(uint32_t);
+constexpr std::size_t MIN_TOKEN_SIZE = sizeof(uint8_t) + MIN_STRING_SIZE + 2 * sizeof(uint32_t);
+
+class ModuleReader {
+    std::istream &is;
+    std::streampos end;
+    uint32_t file;
+    std::vector<ast::ImportStatement *> *imports;
+
+    void check() const {
+        if (!is)
+            throw std::runtime_error("truncated module cache entry");
+    }
+
+public:
+    ModuleReader(std::istream &is, uint32_t file, std::vector<ast::ImportStatement *> *imports = nullptr)
+        : is(is),
+          file(file),
+          imports(imports) {
+        std::streampos start = is.tellg();
+        end = is.seekg(0, std::ios::end).tellg();
+        is.seekg(start);
+    }
+
+    template <class T>
+    T read() {
+        T value;
+        is.read(reinterpret_cast<char *>(&value), sizeof(value));
+        check();
+        return value;
+    }
+
+    // Length of a sequence of elements at least min_size bytes each. Damaged entries could otherwise make us allocate
+    // arbitrary amounts of memory before the stream runs out.
+    uint32_t read_size(std::size_t min_size) {
+        auto size = read<uint32_t>();
+        if ((uint64_t) size * min_size > (uint64_t) (end - is.tellg()))
+            throw std::runtime_error("corrupt module cache entry");
+        return size;
+    }
+
+    std::string read_string() {
+        auto size = read_size(1);
+        std::string string(size, '\0');
+        is.read(string.data(), size);
+        check();
+        return string;
+    }
+
+    LexerRange read_range() {
+        auto offset = read<uint32_t>();
+        auto length = read<uint32_t>();
+        return LexerRange {{file, offset}, length};
+    }
+
+    Token read_token() {
+        auto id = (TokenType) read<uint8_t>();
+        std::string raw = read_string();
+        return Token::symbolic(id, Symbol(raw), read_range());
+    }
+
+    Path read_path() {
+        bool global = read<uint8_t>();
+        auto size = read_size(MIN_STRING_SIZE);
+        std::vector<std::string> parts;
+        parts.reserve(size + global);
+        if (global)
+            parts.emplace_back();
+        for (uint32_t i = 0; i < size; i++)
+            parts.push_back(read_string());
+        return Path(parts, read_range());
+    }
+
+    Type read_type() {
+        auto pointer_level = read<int32_t>();
+        if (read<uint8_t>())
+            return Type((TypeSize) read<uint8_t>(), pointer_level);
+        return Type(read_path(), pointer_level);
+    }
+
+    template <class T>
+    std::vector<T *> read_all() {
+        auto size = read_size(MIN_NODE_SIZE);
+        std::vector<T *> nodes;
+        nodes.reserve(size);
+        for (uint32_t i = 0; i < size; i++)
+            nodes.push_back((T *) read_node());
+        return nodes;
+    }
+
+    ast::Statement *read_node();
+    ast::Expression *read_expression(LexerRange origin);
+};
+
+void ModuleWriter::write_node(ast::Statement *statement) {
+    write((uint8_t) statement->statement_type);
+    write(statement->origin);
+
+    switch (statement->statement_type) {
+    case ast::SCOPE_STMT:
+    case ast::ELSE_STMT:
+        write_all(((ast::ScopeStatement *) statement)->block);
+        break;
+    case ast::FUNC_STMT: {
+        auto *func = (ast::FuncStatement *) statement;
+        write(func->name);
+        write(func->return_type);
+        write_all(func->arguments);
+        write((uint8_t) func->member_of.has_value());
+        if (func->member_of.has_value())
+            write(func->member_of.value());
+        write_all(func->block);
+        break;
+    }
+    case ast::IF_STMT: {
+        auto *if_ = (ast::IfStatement *) statement;
+        write_node(if_->condition);
+        write_all(if_->block);
+        write((uint8_t) (if_->else_statement != nullptr));
+        if (if_->else_statement)
+            write_node(if_->else_statement);
+        break;
+    }
+    case ast::RETURN_STMT: {
+        auto *return_ = (ast::ReturnStatement *) statement;
+        write((uint8_t) (return_->value != nullptr));
+        if (return_->value)
+            write_node(return_->value);
+        break;
+    }
+    case ast::WHILE_STMT: {
+        auto *while_ = (ast::WhileStatement *) statement;
+        write_node(while_->condition);
+        write_all(while_->block);
+        break;
+    }
+    case ast::BREAK_STMT:
+    case ast::CONTINUE_STMT:
+        break;
+    case ast::VARIABLE_STMT: {
+        auto *var = (ast::VariableStatement *) statement;
+        write(var->type);
+        write(var->name);
+        break;
+    }
+    case ast::STRUCT_STMT: {
+        auto *struct_ = (ast::StructStatement *) statement;
+        write(struct_->name);
+        write_all(struct_->members);
+        break;
+    }
+    case ast::IMPORT_STMT: {
+        // The imported file's statements are attached to the import after parsing, so they're never cached here
+        auto *import_ = (ast::ImportStatement *) statement;
+        write(import_->path);
+        write((uint8_t) import_->local);
+        break;
+    }
+    case ast::EXPR_STMT:
+        write_expression((ast::Expression *) statement);
+        break;
+    }
+}
+
+void ModuleWriter::write_expression(ast::Expression *expression) {
+    write((uint8_t) expression->expression_type);
+
+    switch (expression->expression_type) {
+    case ast::CALL_EXPR: {
+        auto *call = (ast::CallExpression *) expression;
+        write_node(call->callee);
+        write_all(call->arguments);
+        break;
+    }
+    case ast::DASH_EXPR:
+    case ast::DOT_EXPR:
+    case ast::EQ_EXPR:
+    case ast::COMP_EXPR:
+    case ast::MEM_ACC_EXPR:
+    case ast::ASSIGN_EXPR:
+    case ast::PATH_EXPR: {
+        auto *binary = (ast::BinaryExpression *) expression;
+        write((uint8_t) binary->bin_op_type);
+        write_node(binary->left);
+        write_node(binary->right);
+        break;
+    }
+    case ast::PREFIX_EXPR: {
+        auto *prefix = (ast::PrefixExpression *) expression;
+        write((uint8_t) prefix->prefix_type);
+        write_node(prefix->operand);
+        break;
+    }
+    case ast::MACRO_NAME_EXPR:
+        write(std::string_view(((ast::MacroNameExpression *) expression)->name));
+        break;
+    case ast::NAME_EXPR:
+        write(std::string_view(((ast::NameExpression *) expression)->name));
+        break;
+    case ast::INT_EXPR:
+        write((int64_t) ((ast::IntExpression *) expression)->n);
+        break;
+    case ast::BOOL_EXPR:
+        write((uint8_t) ((ast::BoolExpression *) expression)->n);
+        break;
+    case ast::REAL_EXPR:
+        write(((ast::RealExpression *) expression)->n);
+        break;
+    case ast::STR_EXPR:
+        write(std::string_view(((ast::StringExpression *) expression)->n));
+        break;
+    case ast::TYPE_EXPR:
+        write(((ast::TypeExpression *) expression)->type);
+        break;
+    case ast::EMPTY_EXPR:
+        break;
+    case ast::CAST_EXPR: {
+        auto *cast = (ast::CastExpression *) expression;
+        write_node(cast->expression);
+        write(cast->target_type);
+        break;
+    }
+    case ast::LIST_EXPR:
+        write_all(((ast::ListExpression *) expression)->elements);
+        break;
+    case ast::STRUCT_INIT_EXPR: {
+        auto *init = (ast::StructInitExpression *) expression;
+        write_node(init->type);
+        write_all(init->fields);
+        break;
+    }
+    }
+}
+
+ast::Statement *ModuleReader::read_node() {
+    auto type = (ast::StmtType) read<uint8_t>();
+    LexerRange origin = read_range();
+
+    // Some constructors widen the origin by their children's, so it's restored from the entry afterwards
+    ast::Statement *statement;
+    switch (type) {
+    case ast::SCOPE_STMT:
+        statement = new ast::ScopeStatement(ast::SCOPE_STMT, origin, read_all<ast::Statement>());
+        break;
+    case ast::ELSE_STMT:
+        statement = new ast::ElseStatement(origin, read_all<ast::Statement>());
+        break;
+    case ast::FUNC_STMT: {
+        Token name = read_token();
+        Type return_type = read_type();
+        std::vector<ast::VariableStatement *> arguments = read_all<ast::VariableStatement>();
+        std::optional<Type> member_of;
+        if (read<uint8_t>())
+            member_of = read_type();
+        std::vector<ast::Statement *> block = read_all<ast::Statement>();
+        statement = new ast::FuncStatement(origin, name, return_type, arguments, block, member_of);
+        break;
+    }
+    case ast::IF_STMT: {
+        auto *condition = (ast::Expression *) read_node();
+        auto *if_ = new ast::IfStatement(origin, condition, read_all<ast::Statement>());
+        if (read<uint8_t>())
+            if_->else_statement = (ast::ElseStatement *) read_node();
+        statement = if_;
+        break;
+    }
+    case ast::RETURN_STMT: {
+        ast::Expression *value = nullptr;
+        if (read<uint8_t>())
+            value = (ast::Expression *) read_node();
+        statement = new ast::ReturnStatement(origin, value);
+        break;
+    }
+    case ast::WHILE_STMT: {
+        auto *condition = (ast::Expression *) read_node();
+        statement = new ast::WhileStatement(origin, condition, read_all<ast::Statement>());
+        break;
+    }
+    case ast::BREAK_STMT:
+        statement = new ast::BreakStatement(origin);
+        break;
+    case ast::CONTINUE_STMT:
+        statement = new ast::ContinueStatement(origin);
+        break;
+    case ast::VARIABLE_STMT: {
+        Type var_type = read_type();
+        statement = new ast::VariableStatement(var_type, read_token());
+        break;
+    }
+    case ast::STRUCT_STMT: {
+        Token name = read_token();
+        statement = new ast::StructStatement(origin, name, read_all<ast::VariableStatement>());
+        break;
+    }
+    case ast::IMPORT_STMT: {
+        Path path = read_path();
+        bool local = read<uint8_t>();
+        auto *import_ = new ast::ImportStatement(origin, path, local, {});
+        if (imports)
+            imports->push_back(import_);
+        statement = import_;
+        break;
+    }
+    case ast::EXPR_STMT:
+        statement = read_expression(origin);
+        break;
+    default:
+        throw std::runtime_error("unknown statement in module cache entry");
+    }
+
+    statement->origin = origin;
+    return statement;
+}
+
+ast::Expression *ModuleReader::read_expression(LexerRange origin) {
+    auto type = (ast::ExprType) read<uint8_t>();
+
+    switch (type) {
+    case ast::CALL_EXPR: {
+        auto *callee = (ast::Expression *) read_node();
+        return new ast::CallExpression(origin, callee, read_all<ast::Expression>());
+    }
+    case ast::DASH_EXPR:
+    case ast::DOT_EXPR:
+    case ast::EQ_EXPR:
+    case ast::COMP_EXPR:
+    case ast::MEM_ACC_EXPR:
+    case ast::ASSIGN_EXPR:
+    case ast::PATH_EXPR: {
+        auto bin_op_type = (ast::BinOpType) read<uint8_t>();
+        auto *left = (ast::Expression *) read_node();
+        auto *right = (ast::Expression *) read_node();
+        return new ast::BinaryExpression(origin, bin_op_type, left, right);
+    }
+    case ast::PREFIX_EXPR: {
+        auto prefix_type = (ast::PrefixType) read<uint8_t>();
+        return new ast::PrefixExpression(origin, prefix_type, (ast::Expression *) read_node());
+    }
+    case ast::MACRO_NAME_EXPR:
+        return new ast::MacroNameExpression(origin, read_string());
+    case ast::NAME_EXPR:
+        return new ast::NameExpression(origin, read_string());
+    case ast::INT_EXPR: {
+        auto *int_ = new ast::IntExpression(origin, "0");
+        int_->n = read<int64_t>();
+        return int_;
+    }
+    case ast::BOOL_EXPR: {
+        auto *bool_ = new ast::BoolExpression(origin, "false");
+        bool_->n = read<uint8_t>();
+        return bool_;
+    }
+    case ast::REAL_EXPR: {
+        auto *real = new ast::RealExpression(origin, "0");
+        real->n = read<double>();
+        return real;
+    }
+    case ast::STR_EXPR:
+        return new ast::StringExpression(origin, read_string());
+    case ast::TYPE_EXPR:
+        return new ast::TypeExpression(read_type(), origin);
+    case ast::EMPTY_EXPR:
+        return new ast::EmptyExpression(origin);
+    case ast::CAST_EXPR: {
+        auto *expression = (ast::Expression *) read_node();
+        return new ast::CastExpression(origin, expression, read_type());
+    }
+    case ast::LIST_EXPR:
+        return new ast::ListExpression(origin, read_all<ast::Expression>());
+    case ast::STRUCT_INIT_EXPR: {
+        auto *struct_type = (ast::Expression *) read_node();
+        return new ast::StructInitExpression(origin, struct_type, read_all<ast::Expression>());
+    }
+    default:
+        throw std::runtime_error("unknown expression in module cache entry");
+    }
+}
+}
+
+ModuleCache::ModuleCache(std::filesystem::path directory)
+    : directory(std::move(directory)) {}
+
+std::filesystem::path ModuleCache::entry_path(const SourceFile &file) const {
+    uint64_t hash = fnv1a(version_id);
+    hash = fnv1a(version_string, hash);
+    hash = fnv1a(file.text(), hash);
+
+    return directory / std::format("{:016x}.tkmc", hash);
+}
+
+std::optional<ModuleCache::Entry> ModuleCache::find(const SourceFile &file) const {
+    std::ifstream in(entry_path(file), std::ios::binary);
+    if (!in)
+        return {};
+
+    char magic[4];
+    in.read(magic, 4);
+    if (!in || std::memcmp(magic, MAGIC, 4) != 0)
+        return {};
+
+    try {
+        ModuleReader reader(in, file.get_id());
+        // A hash collision with a different file is practically impossible, but a different version of the same
+        // format isn't
+        if (reader.read<uint32_t>() != FORMAT_VERSION || reader.read<uint64_t>() != file.text().size())
+            return {};
+
+        Entry entry;
+        entry.file = file.get_id();
+        auto import_count = reader.read_size(MIN_TOKEN_SIZE);
+        entry.imports.reserve(import_count);
+        for (uint32_t i = 0; i < import_count; i++)
+            entry.imports.push_back(reader.read_token());
+
+        entry.statements.assign(std::istreambuf_iterator<char>(in), {});
+        return entry;
+    } catch (const std::exception &) {
+        return {};
+    }
+}
+
+bool ModuleCache::read(const Entry &entry,
+                       std::vector<ast::Statement *> &statements,
+                       std::vector<ast::ImportStatement *> &imports) {
+    std::istringstream in(entry.statements);
+    ModuleReader reader(in, entry.file, &imports);
+
+    try {
+        statements = reader.read_all<ast::Statement>();
+    } catch (const std::exception &) {
+        // Not just our own errors, anything a damaged entry makes the decoder throw means the file is parsed instead
+        return false;
+    }
+    return true;
+}
+
+void ModuleCache::store(const SourceFile &file,
+                        const std::vector<Token> &imports,
+                        const std::vector<ast::Statement *> &statements) const {
+    std::error_code ec;
+    create_directories(directory, ec);
+    if (ec)
+        return;
+
+    std::filesystem::path path = entry_path(file);
+    // Several compilers might store the same entry at once, so every writer gets its own temporary file that is then
+    // renamed into place atomically
+    std::filesystem::path temporary = path;
+    std::random_device random;
+    temporary += std::format(".{:08x}{:08x}.tmp", random(), random());
+
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        if (!out)
+            return;
+
+        out.write(MAGIC, 4);
+        ModuleWriter writer(out);
+        writer.write(FORMAT_VERSION);
+        writer.write((uint64_t) file.text().size());
+        writer.write((uint32_t) imports.size());
+        for (const Token &import_ : imports)
+            writer.write(import_);
+        writer.write_all(statements);
+
+        if (!out) {
+            out.close();
+            remove(temporary, ec);
+            return;
+        }
+    }
+
+    rename(temporary, path, ec);
+    if (ec)
+        remove(temporary, ec);
+}
@@ -0,0 +1,44 @@
+// tarik (c) Nikolas Wipper 2025
+
+#ifndef TARIK_SRC_TLIB_MODULECACHE_H
+#define TARIK_SRC_TLIB_MODULECACHE_H
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+
+#include "lexical/Source.h"
+#include "syntactic/ast/Statements.h"
+
+// Syntax trees of locally imported files, kept on disk between compilations. Entries are keyed by a hash of the
+// file's contents and the compiler version, so they never have to be invalidated; a changed file simply misses.
+class ModuleCache {
+    std::filesystem::path directory;
+
+    std::filesystem::path entry_path(const SourceFile &file) const;
+
+public:
+    struct Entry {
+        // Name tokens of the file's import statements, in source order
+        std::vector<Token> imports;
+        // The serialised statements, only decoded once the entry is actually used
+        std::string statements;
+        uint32_t file;
+    };
+
+    explicit ModuleCache(std::filesystem::path directory);
+
+    std::optional<Entry> find(const SourceFile &file) const;
+    // Decode an entry's statements into the current arena, collecting its import statements in source order. Returns
+    // false if the entry is damaged.
+    static bool read(const Entry &entry,
+                     std::vector<ast::Statement *> &statements,
+                     std::vector<ast::ImportStatement *> &imports);
+    // Failing to write an entry isn't an error, the file is just parsed again next time
+    void store(const SourceFile &file,
+               const std::vector<Token> &imports,
+               const std::vector<ast::Statement *> &statements) const;
+};
+
+#endif //TARIK_SRC_TLIB_MODULECACHE_H
@@ -2,6 +2,8 @@
 
 #include "Serialise.h"
 
+#include "lexical/Source.h"
+
 template <>
 void serialise(std::ostream &os, std::vector<aast::Statement *> vec) {
     size_t i = 0;
@@ -26,15 +28,14 @@ void serialise(std::ostream &os, bool bol) {
     os.write(reinterpret_cast<const char *>(&byte), sizeof(byte));
 }
 
-void serialise(std::ostream &os, const std::string &string) {
+void serialise(std::ostream &os, std::string_view string) {
     serialise(os, string.size());
     os.write(string.data(), string.size());
 }
 
 void serialise(std::ostream &os, const LexerRange &range) {
-    serialise(os, range.filename.string());
-    serialise(os, (size_t) range.l);
-    serialise(os, (size_t) range.p);
+    serialise(os, SourceManager::get(range.file).get_name());
+    serialise(os, (size_t) range.offset);
     serialise(os, (size_t) range.length);
 }
 
@@ -11,7 +11,7 @@
 
 void serialise(std::ostream& os, size_t siz);
 void serialise(std::ostream& os, bool bol);
-void serialise(std::ostream& os, const std::string &string);
+void serialise(std::ostream& os, std::string_view string);
 void serialise(std::ostream &os, const LexerRange &range);
 void serialise(std::ostream& os, Path path);
 void serialise(std::ostream& os, Type type);
@@ -2,7 +2,19 @@
 
 #include "Utf.h"
 
+#include <bit>
 #include <locale>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define TARIK_UTF_SSE2
+    #include <emmintrin.h>
+#endif
+
+#if defined(TARIK_UTF_SSE2) && defined(__GNUC__)
+    #define TARIK_UTF_AVX2
+    #include <immintrin.h>
+#endif
 
 std::string to_string(const std::u32string &utf_string) {
     return std::wstring_convert<deletable_facet<std::codecvt<char32_t, char, std::mbstate_t>>, char32_t>()
@@ -14,6 +26,211 @@ std::u32string to_utf(const std::string &string) {
             .from_bytes(string);
 }
 
+// Length of the 7-bit prefix of text
+static std::size_t ascii_prefix(std::string_view text) {
+    std::size_t i = 0;
+#ifdef TARIK_UTF_SSE2
+    for (; i + 16 <= text.size(); i += 16) {
+        // movemask collects the high bit of every byte
+        uint32_t high = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) (text.data() + i)));
+        if (high)
+            return i + std::countr_zero(high);
+    }
+#endif
+    while (i < text.size() && !(text[i] & 0x80))
+        i++;
+    return i;
+}
+
+bool is_ascii(std::string_view text) {
+    return ascii_prefix(text) == text.size();
+}
+
+// Decodes one character at a time, from i, which has to be the start of a character
+static std::size_t scalar_find_invalid_utf8(std::string_view text, std::size_t i = 0) {
+    while (true) {
+        i += ascii_prefix(text.substr(i));
+        if (i == text.size())
+            return std::string_view::npos;
+
+        auto byte = [&](std::size_t j) -> uint8_t { return i + j < text.size() ? text[i + j] : 0; };
+        auto continuation = [&](std::size_t j) { return (byte(j) & 0xC0) == 0x80; };
+
+        // The ranges of the second byte exclude overlong encodings, surrogates and code points past U+10FFFF
+        uint8_t lead = byte(0);
+        std::size_t length;
+        if (lead >= 0xC2 && lead <= 0xDF)
+            length = 2;
+        else if (lead == 0xE0)
+            length = byte(1) >= 0xA0 ? 3 : 0;
+        else if (lead == 0xED)
+            length = byte(1) < 0xA0 ? 3 : 0;
+        else if (lead >= 0xE1 && lead <= 0xEF)
+            length = 3;
+        else if (lead == 0xF0)
+            length = byte(1) >= 0x90 ? 4 : 0;
+        else if (lead == 0xF4)
+            length = byte(1) < 0x90 ? 4 : 0;
+        else if (lead >= 0xF1 && lead <= 0xF3)
+            length = 4;
+        else
+            length = 0;
+
+        for (std::size_t j = 1; j < length; j++) {
+            if (!continuation(j))
+                length = 0;
+        }
+        if (length == 0)
+            return i;
+        i += length;
+    }
+}
+
+#ifdef TARIK_UTF_AVX2
+#define AVX2 __attribute__((target("avx2")))
+
+// Start of the character that ends at or runs past offset, so the scalar decoder can take over from a vector block
+static std::size_t character_start(std::string_view text, std::size_t offset) {
+    for (std::size_t k = 1; k <= 3 && k <= offset; k++) {
+        auto c = (uint8_t) text[offset - k];
+        if (c < 0x80)
+            break;
+        if (c >= 0xC0)
+            return offset - k;
+    }
+    return offset;
+}
+
+// Bits of the lookup tables, each set for one kind of malformed pair of bytes
+enum : uint8_t {
+    // Lead followed by a non-continuation
+    TOO_SHORT = 1 << 0,
+    // ASCII followed by a continuation
+    TOO_LONG = 1 << 1,
+    // 11100000 100_____
+    OVERLONG_3 = 1 << 2,
+    // 11110100 1001____ and above
+    TOO_LARGE = 1 << 3,
+    // 11101101 101_____
+    SURROGATE = 1 << 4,
+    // 1100000_ 10______
+    OVERLONG_2 = 1 << 5,
+    // 11110101+ 1000____, shares its bit with 11110000 1000____
+    TOO_LARGE_1000 = 1 << 6,
+    OVERLONG_4 = 1 << 6,
+    // Continuation followed by a continuation, only an error if the second one isn't expected
+    TWO_CONTS = 1 << 7,
+    CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS,
+};
+
+// Look up every byte of indices, which must be below 16, in a 16 entry table
+#define AVX2_TABLE(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+AVX2 static __m256i avx2_nibble(__m256i x, int shift) {
+    return _mm256_and_si256(_mm256_srli_epi16(x, shift), _mm256_set1_epi8(0x0F));
+}
+
+// The byte n positions before every byte of input, carried over from the previous block
+AVX2 static __m256i avx2_previous(__m256i input, __m256i previous, int n) {
+    __m256i shifted = _mm256_permute2x128_si256(previous, input, 0x21);
+    switch (n) {
+    case 1:
+        return _mm256_alignr_epi8(input, shifted, 15);
+    case 2:
+        return _mm256_alignr_epi8(input, shifted, 14);
+    default:
+        return _mm256_alignr_epi8(input, shifted, 13);
+    }
+}
+
+// Non-zero bytes where input and the bytes before it aren't well-formed UTF-8. Every pair of bytes is classified by the
+// high and low nibble of the first one and the high nibble of the second, then the second and third continuations of
+// longer sequences are checked against the lead two and three bytes back.
+AVX2 static __m256i avx2_errors(__m256i input, __m256i previous) {
+    __m256i prev1 = avx2_previous(input, previous, 1);
+
+    __m256i byte_1_high = _mm256_shuffle_epi8(
+        AVX2_TABLE(TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+                   TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+                   TOO_SHORT | OVERLONG_2,
+                   TOO_SHORT,
+                   TOO_SHORT | OVERLONG_3 | SURROGATE,
+                   TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4),
+        avx2_nibble(prev1, 4));
+    __m256i byte_1_low = _mm256_shuffle_epi8(
+        AVX2_TABLE(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+                   CARRY | OVERLONG_2,
+                   CARRY,
+                   CARRY,
+                   CARRY | TOO_LARGE,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000,
+                   CARRY | TOO_LARGE | TOO_LARGE_1000),
+        _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)));
+    __m256i byte_2_high = _mm256_shuffle_epi8(
+        AVX2_TABLE(TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+                   TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+                   TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+                   TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                   TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                   TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT),
+        avx2_nibble(input, 4));
+    __m256i special_cases = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    // A continuation two bytes after a three or four byte lead, or three after a four byte lead, is expected; that's
+    // exactly where TWO_CONTS has to be set
+    __m256i third = _mm256_subs_epu8(avx2_previous(input, previous, 2), _mm256_set1_epi8((char) (0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(avx2_previous(input, previous, 3), _mm256_set1_epi8((char) (0xF0 - 0x80)));
+    __m256i expected = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char) 0x80));
+    return _mm256_xor_si256(expected, special_cases);
+}
+
+// Validates 32 bytes at a time. Blocks are only checked for errors, so once one has any, or the text runs out, the
+// scalar decoder finds the exact offset, starting from the character the block starts in.
+AVX2 static std::size_t avx2_find_invalid_utf8(std::string_view text) {
+    // Non-zero where the last bytes of a block start a sequence that continues into the next one
+    const __m256i incomplete_above = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char) (0xF0 - 1), (char) (0xE0 - 1), (char) (0xC0 - 1));
+
+    __m256i previous = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 32 <= text.size(); i += 32) {
+        __m256i input = _mm256_loadu_si256((const __m256i *) (text.data() + i));
+        __m256i errors = _mm256_movemask_epi8(input) ? avx2_errors(input, previous) : incomplete;
+        if (!_mm256_testz_si256(errors, errors))
+            break;
+        incomplete = _mm256_subs_epu8(input, incomplete_above);
+        previous = input;
+    }
+    return scalar_find_invalid_utf8(text, character_start(text, i));
+}
+
+#undef AVX2_TABLE
+#undef AVX2
+#endif
+
+std::size_t find_invalid_utf8(std::string_view text) {
+    static const auto validator = []() -> std::size_t (*)(std::string_view) {
+#ifdef TARIK_UTF_AVX2
+        if (__builtin_cpu_supports("avx2"))
+            return avx2_find_invalid_utf8;
+#endif
+        return [](std::string_view text) { return scalar_find_invalid_utf8(text); };
+    }();
+    return validator(text);
+}
+
 void replace_all(std::string &str, const std::string &needle, const std::string &replace) {
     // Add four spaces to the start of every line
     size_t index = 0;
@@ -4,6 +4,7 @@
 #define UTF_H
 
 #include <string>
+#include <string_view>
 
 template <class Facet>
 struct deletable_facet : Facet {
@@ -17,6 +18,11 @@ struct deletable_facet : Facet {
 std::string to_string(const std::u32string& utf_string);
 std::u32string to_utf(const std::string& string);
 
+// True if text only contains 7-bit characters, in which case none of the conversions above are needed
+bool is_ascii(std::string_view text);
+// Offset of the first byte that isn't part of a well-formed UTF-8 sequence, or npos if text is valid UTF-8
+std::size_t find_invalid_utf8(std::string_view text);
+
 void replace_all(std::string &str, const std::string &needle, const std::string &replace);
 
 #endif //UTF_H